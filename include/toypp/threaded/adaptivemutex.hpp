@@ -0,0 +1,113 @@
+#ifndef TOYPP_THREADED_ADAPTIVEMUTEX_HPP_
+#define TOYPP_THREADED_ADAPTIVEMUTEX_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "futex.hpp"
+#include "hardware.hpp"
+
+namespace tpp {
+
+/**
+ * @brief A mutex that spins for a while, then sleeps on a futex.
+ *
+ * Its word is 0 when unlocked, 1 when locked, and 2 when locked with
+ * (maybe) someone sleeping, so `unlock` makes the wake-up syscall only
+ * then (as in Drepper's "Futexes Are Tricky").
+ *
+ * How long `lock` spins adapts to how long it took to get the lock by
+ * spinning lately, like glibc's adaptive mutexes: short critical sections
+ * get handed over without a syscall on either side, while waiting for
+ * long ones doesn't burn a cpu for more than a few spins. With a single
+ * cpu it doesn't spin at all.
+ *
+ * Same interface as SpinMutex.
+ */
+class AdaptiveMutex {
+  static constexpr std::uint32_t unlocked = 0;
+  static constexpr std::uint32_t locked = 1;
+  static constexpr std::uint32_t sleepers = 2;  // locked, maybe with sleepers.
+
+  static constexpr std::uint32_t max_spins = 256;
+
+  std::atomic<std::uint32_t> state_{unlocked};
+  std::atomic<std::uint32_t> spin_estimate_{16};  // a moving average.
+
+ public:
+  AdaptiveMutex() {}
+  AdaptiveMutex(const AdaptiveMutex&) = delete;
+  AdaptiveMutex& operator=(const AdaptiveMutex&) = delete;
+
+  void lock() noexcept {
+    auto state = unlocked;
+    if (state_.compare_exchange_strong(state, locked,
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed))
+      return;
+
+    if (spin_to_lock()) return;
+
+    // from now on it's marked as having sleepers, as this one might be.
+    while (state_.exchange(sleepers, std::memory_order_acquire) != unlocked)
+      futex_wait(state_, sleepers);
+  }
+
+  bool try_lock() noexcept {
+    auto state = unlocked;
+    return state_.compare_exchange_strong(state, locked,
+                                          std::memory_order_acquire,
+                                          std::memory_order_relaxed);
+  }
+
+  void unlock() noexcept {
+    if (state_.exchange(unlocked, std::memory_order_release) == sleepers)
+      futex_wake_one(state_);
+  }
+
+  void acquire() noexcept { lock(); }
+  void release() noexcept { unlock(); }
+
+ private:
+  /// spins up to about twice as long as it recently took,
+  /// and returns whether it got the lock.
+  bool spin_to_lock() noexcept {
+    // with a single cpu, the holder can't release it while this spins.
+    static const bool spinning_helps = std::thread::hardware_concurrency() > 1;
+    if (!spinning_helps) return false;
+
+    const auto estimate = spin_estimate_.load(std::memory_order_relaxed);
+    const auto limit = estimate * 2 + 16 < max_spins ? estimate * 2 + 16
+                                                     : max_spins;
+
+    std::uint32_t spins = 0;
+    while (spins < limit) {
+      ++spins;
+      cpu_relax();
+      auto state = state_.load(std::memory_order_relaxed);
+      if (state == unlocked
+          && state_.compare_exchange_weak(state, locked,
+                                          std::memory_order_acquire,
+                                          std::memory_order_relaxed)) {
+        update_estimate(estimate, spins);
+        return true;
+      }
+      if (state == sleepers) break;  // others gave up already.
+    }
+
+    update_estimate(estimate, spins);
+    return false;
+  }
+
+  void update_estimate(std::uint32_t estimate, std::uint32_t spins) noexcept {
+    // a racy read-modify-write is fine for a heuristic.
+    const auto next = static_cast<std::uint32_t>(
+        (static_cast<std::int64_t>(estimate) * 7 + spins) / 8);
+    spin_estimate_.store(next, std::memory_order_relaxed);
+  }
+};
+
+}  // namespace tpp
+
+#endif  // TOYPP_THREADED_ADAPTIVEMUTEX_HPP_
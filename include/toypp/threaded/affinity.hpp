@@ -0,0 +1,189 @@
+#ifndef TOYPP_THREADED_AFFINITY_HPP_
+#define TOYPP_THREADED_AFFINITY_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace tpp {
+
+/// how a thread pool places its workers on cpus.
+enum class Affinity {
+  none,           // not pinned, the os schedules them anywhere.
+  compact,        // fill up a numa node before moving on to the next one.
+  scatter,        // spread round-robin over the numa nodes.
+  explicit_cpus,  // worker i runs on the i-th of a given list of cpus.
+};
+
+/**
+ * @brief The cpus of each numa node.
+ *
+ * On linux it's read from `/sys/devices/system/node`,
+ * elsewhere (or when that's missing) it's a single node of all cpus.
+ */
+class CpuTopology {
+  std::vector<std::vector<int>> nodes_;
+
+ public:
+  CpuTopology() : CpuTopology(detect_nodes()) {}
+
+  explicit CpuTopology(std::vector<std::vector<int>> nodes)
+    : nodes_(std::move(nodes))
+  {
+    if (nodes_.empty())
+      nodes_.push_back(all_cpus());
+  }
+
+  const std::vector<std::vector<int>>& nodes() const noexcept {
+    return nodes_;
+  }
+
+  std::size_t nodes_count() const noexcept { return nodes_.size(); }
+
+  /// index of the node holding `cpu`, or 0 if it's unknown.
+  std::size_t node_of(int cpu) const noexcept {
+    for (std::size_t i = 0; i < nodes_.size(); ++i)
+      for (int x : nodes_[i])
+        if (x == cpu) return i;
+    return 0;
+  }
+
+  /// cpu for each of `count` workers, or -1 for ones not to be pinned.
+  std::vector<int> assign(Affinity affinity, std::size_t count,
+                          const std::vector<int>& cpus = {}) const {
+    std::vector<int> result(count, -1);
+
+    switch (affinity) {
+      case Affinity::none:
+        break;
+
+      case Affinity::compact: {
+        std::vector<int> flat;
+        for (const auto& node : nodes_)
+          flat.insert(flat.end(), node.begin(), node.end());
+        for (std::size_t i = 0; i < count && !flat.empty(); ++i)
+          result[i] = flat[i % flat.size()];
+        break;
+      }
+
+      case Affinity::scatter:
+        for (std::size_t i = 0; i < count; ++i) {
+          const auto& node = nodes_[i % nodes_.size()];
+          if (!node.empty())
+            result[i] = node[(i / nodes_.size()) % node.size()];
+        }
+        break;
+
+      case Affinity::explicit_cpus:
+        for (std::size_t i = 0; i < count && !cpus.empty(); ++i)
+          result[i] = cpus[i % cpus.size()];
+        break;
+    }
+
+    return result;
+  }
+
+  /// parses a linux cpu list such as "0-3,8,10-11".
+  static std::vector<int> parse_cpu_list(const std::string& list) {
+    std::vector<int> cpus;
+    std::istringstream stream{list};
+    std::string part;
+
+    while (std::getline(stream, part, ',')) {
+      if (part.find_first_of("0123456789") == std::string::npos) continue;
+
+      const auto dash = part.find('-');
+      const int first = std::stoi(part.substr(0, dash));
+      const int last = dash == std::string::npos
+                         ? first
+                         : std::stoi(part.substr(dash + 1));
+      for (int cpu = first; cpu <= last; ++cpu)
+        cpus.push_back(cpu);
+    }
+
+    return cpus;
+  }
+
+ private:
+  static std::vector<int> all_cpus() {
+    std::vector<int> cpus(std::max(1u, std::thread::hardware_concurrency()));
+    for (std::size_t i = 0; i < cpus.size(); ++i)
+      cpus[i] = static_cast<int>(i);
+    return cpus;
+  }
+
+  static std::vector<std::vector<int>> detect_nodes() {
+    std::vector<std::vector<int>> nodes;
+
+#if defined(__linux__)
+    const std::string root = "/sys/devices/system/node/";
+
+    std::ifstream online_file{root + "online"};
+    std::string online;
+    if (!std::getline(online_file, online)) return nodes;
+
+    for (int id : parse_cpu_list(online)) {
+      const auto path = root + "node" + std::to_string(id) + "/cpulist";
+      std::ifstream cpulist_file{path};
+      std::string cpulist;
+      if (!std::getline(cpulist_file, cpulist)) continue;
+
+      auto cpus = parse_cpu_list(cpulist);
+      if (!cpus.empty())
+        nodes.push_back(std::move(cpus));  // skips memory only nodes.
+    }
+#endif
+
+    return nodes;
+  }
+};
+
+/// pins the calling thread to `cpu`; false if it couldn't (or isn't linux).
+inline bool pin_current_thread(int cpu) noexcept {
+#if defined(__linux__)
+  if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) == 0;
+#else
+  (void)cpu;
+  return false;
+#endif
+}
+
+/// names the calling thread for debuggers and tools like perf and htop.
+/// linux allows at most 15 characters, so the rest is cut off.
+inline void name_current_thread(const std::string& name) noexcept {
+#if defined(__linux__)
+  char buffer[16] = {};
+  name.copy(buffer, sizeof(buffer) - 1);
+  ::pthread_setname_np(::pthread_self(), buffer);
+#else
+  (void)name;
+#endif
+}
+
+/// cpu the calling thread runs on at the moment, or -1 if unknown.
+inline int current_cpu() noexcept {
+#if defined(__linux__)
+  return ::sched_getcpu();
+#else
+  return -1;
+#endif
+}
+
+}  // namespace tpp
+
+#endif  // TOYPP_THREADED_AFFINITY_HPP_
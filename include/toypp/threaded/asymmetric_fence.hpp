@@ -0,0 +1,68 @@
+#ifndef TOYPP_THREADED_ASYMMETRIC_FENCE_HPP_
+#define TOYPP_THREADED_ASYMMETRIC_FENCE_HPP_
+
+#include <atomic>
+
+#if defined(__linux__)
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace tpp {
+
+/**
+ * A seq_cst fence split into a cheap and an expensive half, for Dekker-like
+ * handshakes where one side runs all the time and the other one rarely.
+ *
+ * A `light_fence` in one thread and a `heavy_fence` in another one order
+ * memory like two `std::atomic_thread_fence(seq_cst)` would. On linux the
+ * heavy one is a `membarrier` syscall, which makes every running thread of
+ * the process go through a full barrier, so the light one costs nothing
+ * but stopping the compiler. Elsewhere (or on old kernels) both of them are
+ * plain seq_cst fences.
+ */
+
+namespace detail {
+
+inline auto membarrier_registered() noexcept -> bool
+{
+#if defined(__linux__) && defined(SYS_membarrier)
+  static const bool registered = [] {
+    const long commands = ::syscall(SYS_membarrier, MEMBARRIER_CMD_QUERY,
+                                    0, 0);
+    return commands > 0
+           && (commands & MEMBARRIER_CMD_PRIVATE_EXPEDITED) != 0
+           && ::syscall(SYS_membarrier,
+                        MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0;
+  }();
+  return registered;
+#else
+  return false;
+#endif
+}
+
+}  // namespace detail
+
+inline void light_fence() noexcept
+{
+  if (detail::membarrier_registered())
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+  else
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+inline void heavy_fence() noexcept
+{
+#if defined(__linux__) && defined(SYS_membarrier)
+  if (detail::membarrier_registered()) {
+    ::syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0);
+    return;
+  }
+#endif
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+}  // namespace tpp
+
+#endif  // TOYPP_THREADED_ASYMMETRIC_FENCE_HPP_
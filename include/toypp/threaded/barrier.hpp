@@ -0,0 +1,97 @@
+#ifndef TOYPP_THREADED_BARRIER_HPP_
+#define TOYPP_THREADED_BARRIER_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+#include "futex.hpp"
+
+namespace tpp {
+
+/**
+ * @brief A reusable barrier for a fixed set of threads (as `std::barrier`).
+ *
+ * Each phase, every thread arrives once; the last one to arrive runs the
+ * completion function (if any), and then lets them all go on to the next
+ * phase. Threads wait on the phase number, a futex word, so the wake-up
+ * call is made only when someone went to sleep.
+ *
+ * `arrive_and_wait(pool)` runs the pool's pending tasks while it waits.
+ * The completion function shouldn't throw.
+ */
+class Barrier {
+  std::atomic<std::uint32_t> phase_{0};
+  std::atomic<std::uint32_t> remaining_;
+  std::atomic<std::uint32_t> expected_;  // less the dropped ones.
+  std::function<void()> on_completion_;
+
+ public:
+  explicit Barrier(std::uint32_t count,
+                   std::function<void()> on_completion = {})
+    : remaining_(count)
+    , expected_(count)
+    , on_completion_(std::move(on_completion))
+  {}
+
+  Barrier(const Barrier&) = delete;
+  Barrier& operator=(const Barrier&) = delete;
+
+  /// phases completed so far (wrapping around at 2^31).
+  std::uint32_t phase() const noexcept {
+    return phase_.load(std::memory_order_acquire) & ~detail::sleepers_bit;
+  }
+
+  /// arrives without waiting; returns the phase it arrived in, to pass to
+  /// `wait`.
+  std::uint32_t arrive() noexcept {
+    // it can't move on before this one arrives.
+    const auto phase = this->phase();
+    if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      complete(phase);
+    return phase;
+  }
+
+  /// waits for the end of `phase` (the one `arrive` returned).
+  void wait(std::uint32_t phase) noexcept {
+    detail::wait_until(phase_,
+                       [phase](std::uint32_t now) { return now != phase; });
+  }
+
+  template <typename Pool>
+  void wait(std::uint32_t phase, Pool& pool) {
+    detail::wait_until_helping(
+        pool, phase_, [phase](std::uint32_t now) { return now != phase; });
+  }
+
+  void arrive_and_wait() noexcept { wait(arrive()); }
+
+  /// waits, running `pool`'s (e.g. a ThreadPool) pending tasks meanwhile.
+  template <typename Pool>
+  void arrive_and_wait(Pool& pool) {
+    wait(arrive(), pool);
+  }
+
+  /// leaves the barrier for good, without waiting for this phase's end.
+  void arrive_and_drop() noexcept {
+    expected_.fetch_sub(1, std::memory_order_relaxed);
+    arrive();
+  }
+
+ private:
+  void complete(std::uint32_t phase) noexcept {
+    if (on_completion_) on_completion_();
+
+    // resets the count before letting anyone arrive in the next phase.
+    remaining_.store(expected_.load(std::memory_order_relaxed),
+                     std::memory_order_relaxed);
+    const auto next = (phase + 1) & ~detail::sleepers_bit;
+    detail::wake_sleepers(phase_,
+                          phase_.exchange(next, std::memory_order_acq_rel));
+  }
+};
+
+}  // namespace tpp
+
+#endif  // TOYPP_THREADED_BARRIER_HPP_
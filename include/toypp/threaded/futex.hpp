@@ -0,0 +1,196 @@
+#ifndef TOYPP_THREADED_FUTEX_HPP_
+#define TOYPP_THREADED_FUTEX_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "hardware.hpp"
+
+#if defined(__linux__)
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#endif
+
+namespace tpp {
+
+/**
+ * Minimal futex-like wait/wake on a 32bit atomic word.
+ *
+ * `futex_wait` blocks only if `word` still holds `expected`,
+ * and may return spuriously, so callers must re-check their condition.
+ * `futex_wait_for` also returns once `timeout` has passed.
+ * On linux these are direct futex syscalls, elsewhere they fall back to
+ * a small table of mutex/condition_variable pairs hashed by address.
+ */
+
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t),
+              "futex word must be a plain 32bit integer.");
+
+#if defined(__linux__)
+
+inline void futex_wait(std::atomic<std::uint32_t>& word,
+                       std::uint32_t expected) noexcept {
+  ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word),
+            FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+}
+
+inline void futex_wait_for(std::atomic<std::uint32_t>& word,
+                           std::uint32_t expected,
+                           std::chrono::nanoseconds timeout) noexcept {
+  if (timeout <= std::chrono::nanoseconds::zero()) return;
+
+  const auto count = timeout.count();
+  timespec relative{};
+  relative.tv_sec = static_cast<std::time_t>(count / 1'000'000'000);
+  relative.tv_nsec = static_cast<long>(count % 1'000'000'000);
+  ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word),
+            FUTEX_WAIT_PRIVATE, expected, &relative, nullptr, 0);
+}
+
+inline void futex_wake_one(std::atomic<std::uint32_t>& word) noexcept {
+  ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word),
+            FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+
+inline void futex_wake_all(std::atomic<std::uint32_t>& word) noexcept {
+  ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word),
+            FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+}
+
+#else
+
+namespace detail {
+
+struct FutexBucket {
+  std::mutex mutex;
+  std::condition_variable cv;
+};
+
+inline FutexBucket& futex_bucket(const void* address) noexcept {
+  static FutexBucket buckets[64];
+  return buckets[std::hash<const void*>{}(address) % 64];
+}
+
+}  // namespace detail
+
+inline void futex_wait(std::atomic<std::uint32_t>& word,
+                       std::uint32_t expected) noexcept {
+  auto& bucket = detail::futex_bucket(&word);
+  std::unique_lock<std::mutex> lock{bucket.mutex};
+  if (word.load(std::memory_order_relaxed) == expected)
+    bucket.cv.wait(lock);
+}
+
+inline void futex_wait_for(std::atomic<std::uint32_t>& word,
+                           std::uint32_t expected,
+                           std::chrono::nanoseconds timeout) noexcept {
+  if (timeout <= std::chrono::nanoseconds::zero()) return;
+
+  auto& bucket = detail::futex_bucket(&word);
+  std::unique_lock<std::mutex> lock{bucket.mutex};
+  if (word.load(std::memory_order_relaxed) == expected)
+    bucket.cv.wait_for(lock, timeout);
+}
+
+inline void futex_wake_all(std::atomic<std::uint32_t>& word) noexcept {
+  auto& bucket = detail::futex_bucket(&word);
+  { std::lock_guard<std::mutex> lock{bucket.mutex}; }
+  bucket.cv.notify_all();
+}
+
+// buckets are shared between words, so waking one might wake the wrong one.
+inline void futex_wake_one(std::atomic<std::uint32_t>& word) noexcept {
+  futex_wake_all(word);
+}
+
+#endif
+
+namespace detail {
+
+/// the top bit of a word waited on with the helpers below, set while someone
+/// (maybe) sleeps on it, so whoever changes the rest of it (e.g. a count)
+/// makes the wake-up call only then. clearing it with that same change
+/// means waking doesn't touch the word afterwards, as it may be gone.
+constexpr std::uint32_t sleepers_bit = std::uint32_t{1} << 31;
+
+/// marks `word`, last read as `value`, as having sleepers, and sleeps on it
+/// (for at most `timeout`, if there is one); returns early if it changed.
+inline void mark_and_sleep(std::atomic<std::uint32_t>& word,
+                           std::uint32_t value,
+                           std::chrono::nanoseconds timeout = {}) noexcept {
+  if (!(value & sleepers_bit)) {
+    if (!word.compare_exchange_strong(value, value | sleepers_bit,
+                                      std::memory_order_relaxed))
+      return;
+    value |= sleepers_bit;
+  }
+
+  if (timeout > std::chrono::nanoseconds::zero())
+    futex_wait_for(word, value, timeout);
+  else
+    futex_wait(word, value);
+}
+
+/// to call with the value the word had before it was changed.
+inline void wake_sleepers(std::atomic<std::uint32_t>& word,
+                          std::uint32_t previous) noexcept {
+  if (previous & sleepers_bit) futex_wake_all(word);
+}
+
+/// waits until `done(value)` holds for the word's value (without the bit),
+/// spinning briefly before it sleeps.
+template <typename Done>
+void wait_until(std::atomic<std::uint32_t>& word, Done&& done) noexcept {
+  for (std::uint32_t round = 0;; ++round) {
+    const auto value = word.load(std::memory_order_acquire);
+    if (done(value & ~sleepers_bit)) return;
+
+    if (round < 64)
+      cpu_relax();
+    else
+      mark_and_sleep(word, value);
+  }
+}
+
+/// like wait_until, but runs `pool`'s pending tasks meanwhile, so a worker
+/// waiting on other tasks doesn't keep them from running. new tasks don't
+/// wake it up, so with none to run it yields a few times, then only naps,
+/// a little longer each time.
+template <typename Pool, typename Done>
+void wait_until_helping(Pool& pool, std::atomic<std::uint32_t>& word,
+                        Done&& done) {
+  constexpr std::uint32_t yields = 16;
+  constexpr std::chrono::nanoseconds min_nap = std::chrono::microseconds{50};
+  constexpr std::chrono::nanoseconds max_nap = std::chrono::milliseconds{2};
+
+  std::uint32_t idle = 0;
+  auto nap = min_nap;
+  while (true) {
+    const auto value = word.load(std::memory_order_acquire);
+    if (done(value & ~sleepers_bit)) return;
+
+    if (pool.run_pending_task()) {
+      idle = 0;
+      nap = min_nap;
+    } else if (++idle <= yields) {
+      std::this_thread::yield();
+    } else {
+      mark_and_sleep(word, value, nap);
+      nap = nap * 2 < max_nap ? nap * 2 : max_nap;
+    }
+  }
+}
+
+}  // namespace detail
+
+}  // namespace tpp
+
+#endif  // TOYPP_THREADED_FUTEX_HPP_
@@ -0,0 +1,185 @@
+#ifndef TOYPP_THREADED_FUTURE_HPP_
+#define TOYPP_THREADED_FUTURE_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "futex.hpp"
+
+namespace tpp {
+
+namespace detail {
+
+/**
+ * Shared state between a producer (e.g. a task) and a `Future`.
+ *
+ * It's reference counted and meant to be a base of the producer object,
+ * so the producer and the state live in a single allocation.
+ * An lvalue reference result is kept as a pointer to the referred object.
+ */
+template <typename T>
+class FutureState {
+  static_assert(!std::is_rvalue_reference<T>::value,
+                "a future can't hold an rvalue reference, return by value.");
+
+ public:
+  using value_type = T;
+
+ private:
+  using storage_type =
+      std::conditional_t<std::is_void<T>::value, bool,
+        std::conditional_t<std::is_reference<T>::value,
+                           std::remove_reference_t<T>*, T>>;
+
+  enum : std::uint32_t {
+    pending_status = 0,
+    ready_status = 1,
+    broken_status = 2,
+    waiting_flag = 4,  // someone is (about to be) blocked in futex_wait.
+  };
+
+  std::atomic<std::uint32_t> status_{pending_status};
+  std::atomic<std::uint32_t> refs_{2};  // producer + future.
+  std::optional<storage_type> value_;
+  std::exception_ptr error_;
+
+  std::uint32_t status() const noexcept {
+    return status_.load(std::memory_order_acquire) & ~waiting_flag;
+  }
+
+  void complete(std::uint32_t status) noexcept {
+    if (status_.exchange(status, std::memory_order_acq_rel) & waiting_flag)
+      futex_wake_all(status_);
+  }
+
+ protected:
+  template <typename ...Args>
+  void set_value(Args&&... args) {
+    if constexpr (std::is_reference<T>::value)
+      value_.emplace(std::addressof(args)...);
+    else
+      value_.emplace(std::forward<Args>(args)...);
+    complete(ready_status);
+  }
+
+  void set_exception(std::exception_ptr error) noexcept {
+    error_ = std::move(error);
+    complete(ready_status);
+  }
+
+  /// marks the state as abandoned if no result was set.
+  void set_broken() noexcept {
+    if (status() == pending_status)
+      complete(broken_status);
+  }
+
+ public:
+  FutureState() = default;
+  FutureState(const FutureState&) = delete;
+  FutureState& operator=(const FutureState&) = delete;
+  virtual ~FutureState() = default;
+
+  void release() noexcept {
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      delete this;
+  }
+
+  bool ready() const noexcept {
+    return status() != pending_status;
+  }
+
+  void wait() noexcept {
+    auto status = status_.load(std::memory_order_acquire);
+    while ((status & ~waiting_flag) == pending_status) {
+      if (!(status & waiting_flag)
+          && !status_.compare_exchange_weak(status, status | waiting_flag,
+                                            std::memory_order_acquire))
+        continue;
+
+      futex_wait(status_, pending_status | waiting_flag);
+      status = status_.load(std::memory_order_acquire);
+    }
+  }
+
+  T take() {
+    wait();
+
+    if (error_)
+      std::rethrow_exception(error_);
+
+    if (!value_)
+      throw std::future_error(std::future_errc::broken_promise);
+
+    if constexpr (std::is_reference<T>::value)
+      return **value_;
+    else if constexpr (!std::is_void<T>::value)
+      return std::move(*value_);
+  }
+};
+
+}  // namespace detail
+
+/**
+ * @brief A move-only handle to the result of an asynchronous task.
+ *
+ * Unlike `std::future`, the shared state is allocated together with the
+ * task that produces it (see `ThreadPool::submit`).
+ * If the task is dropped without running (e.g. `ThreadPool::force_shutdown`),
+ * `get` throws `std::future_error` with `broken_promise`.
+ * `T` may be an lvalue reference (e.g. a task returning `int&`),
+ * but not an rvalue reference.
+ */
+template <typename T>
+class Future {
+ public:
+  using value_type = T;
+
+ private:
+  detail::FutureState<T>* state_ = nullptr;
+
+ public:
+  Future() noexcept {}
+  explicit Future(detail::FutureState<T>* state) noexcept : state_(state) {}
+
+  Future(const Future&) = delete;
+  Future& operator=(const Future&) = delete;
+
+  Future(Future&& other) noexcept
+    : state_(std::exchange(other.state_, nullptr))
+  {}
+
+  Future& operator=(Future&& other) noexcept {
+    if (this != &other) {
+      if (state_) state_->release();
+      state_ = std::exchange(other.state_, nullptr);
+    }
+    return *this;
+  }
+
+  ~Future() {
+    if (state_) state_->release();
+  }
+
+  bool valid() const noexcept { return state_ != nullptr; }
+
+  /// non-blocking check whether the result (or error) is available.
+  bool ready() const noexcept { return state_ && state_->ready(); }
+
+  void wait() const noexcept { state_->wait(); }
+
+  /// waits for and returns the result, leaving the future invalid.
+  T get() {
+    Future owned = std::move(*this);
+    return owned.state_->take();
+  }
+};
+
+}  // namespace tpp
+
+#endif  // TOYPP_THREADED_FUTURE_HPP_
@@ -0,0 +1,51 @@
+#ifndef TOYPP_THREADED_HARDWARE_HPP_
+#define TOYPP_THREADED_HARDWARE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#endif
+
+namespace tpp {
+
+/// size used to pad data that is written by different threads,
+/// so they won't share (and ping-pong) a cache line.
+constexpr std::size_t cache_line_size = 64;
+
+/// hints the cpu that this is a spin-wait loop (e.g. x86 `pause`),
+/// which saves power and frees resources for the sibling hyper-thread.
+inline void cpu_relax() noexcept {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  _mm_pause();
+#elif defined(__i386__) || defined(__x86_64__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+/// exponential backoff for spin-wait loops: each call pauses twice as long
+/// as the one before, until that gets long, then it yields instead
+/// (so spinning still works out with more threads than cpus).
+class SpinBackoff {
+  static constexpr std::uint32_t max_pauses = 64;
+
+  std::uint32_t pauses_ = 1;
+
+ public:
+  void operator()() noexcept {
+    if (pauses_ <= max_pauses) {
+      for (std::uint32_t i = 0; i < pauses_; ++i) cpu_relax();
+      pauses_ *= 2;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+};
+
+}  // namespace tpp
+
+#endif  // TOYPP_THREADED_HARDWARE_HPP_
@@ -0,0 +1,96 @@
+#ifndef TOYPP_THREADED_HISTOGRAM_HPP_
+#define TOYPP_THREADED_HISTOGRAM_HPP_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace tpp {
+
+/// nanoseconds on the steady clock, for cheap timestamps to subtract.
+inline std::int64_t steady_clock_ns() noexcept {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief A lock-free histogram of durations in log2 buckets.
+ *
+ * Bucket `i` counts values in [2^i, 2^(i+1)) nanoseconds (bucket 0 also
+ * takes 0). Recording is a single relaxed increment, so it's cheap enough
+ * for hot paths and can be read while being written, though a read
+ * isn't an atomic snapshot of all buckets.
+ */
+class LatencyHistogram {
+ public:
+  static constexpr std::size_t buckets_count = 64;
+
+ private:
+  std::array<std::atomic<std::uint64_t>, buckets_count> buckets_{};
+
+  static std::size_t bucket_of(std::uint64_t value) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    return value ? 63 - static_cast<std::size_t>(__builtin_clzll(value)) : 0;
+#else
+    std::size_t index = 0;
+    while (value >>= 1) ++index;
+    return index;
+#endif
+  }
+
+ public:
+  LatencyHistogram() noexcept = default;
+  LatencyHistogram(const LatencyHistogram&) = delete;
+  LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+  void record(std::int64_t nanoseconds) noexcept {
+    const auto value = nanoseconds > 0
+                         ? static_cast<std::uint64_t>(nanoseconds) : 0;
+    buckets_[bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  std::uint64_t bucket(std::size_t index) const noexcept {
+    return buckets_[index].load(std::memory_order_relaxed);
+  }
+
+  /// least value (in nanoseconds) of `index`th bucket.
+  static std::uint64_t bucket_floor(std::size_t index) noexcept {
+    return index ? std::uint64_t{1} << index : 0;
+  }
+
+  std::uint64_t count() const noexcept {
+    std::uint64_t total = 0;
+    for (const auto& bucket : buckets_)
+      total += bucket.load(std::memory_order_relaxed);
+    return total;
+  }
+
+  /// upper bound (exclusive, in nanoseconds) of the bucket that holds
+  /// the `p`th percentile (0 < p <= 100), or 0 if nothing is recorded.
+  std::uint64_t percentile(double p) const noexcept {
+    std::array<std::uint64_t, buckets_count> counts;
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < buckets_count; ++i)
+      total += counts[i] = bucket(i);
+    if (total == 0) return 0;
+
+    const auto rank = static_cast<std::uint64_t>(p / 100.0 * total);
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i + 1 < buckets_count; ++i) {
+      seen += counts[i];
+      if (seen > 0 && seen >= rank) return bucket_floor(i + 1);
+    }
+    return UINT64_MAX;
+  }
+
+  void reset() noexcept {
+    for (auto& bucket : buckets_)
+      bucket.store(0, std::memory_order_relaxed);
+  }
+};
+
+}  // namespace tpp
+
+#endif  // TOYPP_THREADED_HISTOGRAM_HPP_
@@ -0,0 +1,65 @@
+#ifndef TOYPP_THREADED_LATCH_HPP_
+#define TOYPP_THREADED_LATCH_HPP_
+
+#include <atomic>
+#include <cstdint>
+
+#include "futex.hpp"
+
+namespace tpp {
+
+/**
+ * @brief A single use countdown that threads can wait on (as `std::latch`).
+ *
+ * The count is a futex word, so counting down is a single atomic op, which
+ * makes the wake-up call only when it reaches zero with someone asleep.
+ * Counting down last is its last touch of the latch, so whoever waited may
+ * destroy it right away.
+ *
+ * `wait(pool)` runs the pool's pending tasks while it waits, so a pool
+ * worker can wait on tasks it submitted itself.
+ */
+class Latch {
+  std::atomic<std::uint32_t> count_;
+
+ public:
+  explicit Latch(std::uint32_t count) noexcept : count_(count) {}
+  Latch(const Latch&) = delete;
+  Latch& operator=(const Latch&) = delete;
+
+  /// how many count downs are left.
+  std::uint32_t count() const noexcept {
+    return count_.load(std::memory_order_relaxed) & ~detail::sleepers_bit;
+  }
+
+  void count_down(std::uint32_t n = 1) noexcept {
+    const auto previous = count_.fetch_sub(n, std::memory_order_acq_rel);
+    if ((previous & ~detail::sleepers_bit) == n)
+      detail::wake_sleepers(count_, previous);
+  }
+
+  bool try_wait() const noexcept {
+    return (count_.load(std::memory_order_acquire) & ~detail::sleepers_bit)
+           == 0;
+  }
+
+  void wait() noexcept {
+    detail::wait_until(count_, [](std::uint32_t count) { return count == 0; });
+  }
+
+  /// waits, running `pool`'s (e.g. a ThreadPool) pending tasks meanwhile.
+  template <typename Pool>
+  void wait(Pool& pool) {
+    detail::wait_until_helping(pool, count_,
+                               [](std::uint32_t count) { return count == 0; });
+  }
+
+  void arrive_and_wait(std::uint32_t n = 1) noexcept {
+    count_down(n);
+    wait();
+  }
+};
+
+}  // namespace tpp
+
+#endif  // TOYPP_THREADED_LATCH_HPP_
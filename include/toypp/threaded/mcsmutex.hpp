@@ -0,0 +1,172 @@
+#ifndef TOYPP_THREADED_MCSMUTEX_HPP_
+#define TOYPP_THREADED_MCSMUTEX_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+
+#include "hardware.hpp"
+
+namespace tpp {
+
+/**
+ * @brief A fair (FIFO) queue spin lock of Mellor-Crummey and Scott.
+ *
+ * Each waiter appends a node of its own to a linked queue with a single
+ * exchange on the tail, then spins on a flag in that node, on its own cache
+ * line, which its predecessor clears when unlocking. So a release touches
+ * only the next waiter's line, however many there are.
+ *
+ * To keep SpinMutex's interface, the nodes don't come from the caller but
+ * from a per-thread pool (allocated on first use and freed with the
+ * thread, it can still be locked from thread_local destructors), and the
+ * holder's node is kept in the lock for `unlock`.
+ * As for any mutex, it has to be unlocked by the thread that locked it.
+ */
+class McsMutex {
+  static constexpr std::uint32_t yield_after = 1024;  // spins.
+
+  struct alignas(cache_line_size) Node {
+    std::atomic<Node*> next{nullptr};
+    std::atomic<bool> locked{false};
+    Node* pooled = nullptr;  // next free one in the thread's pool.
+  };
+
+  /// a thread's free nodes. it's trivially destructible, so it's still
+  /// there for locks taken while the thread's other thread_locals are
+  /// destroyed; a Reaper frees the nodes at thread exit instead, after
+  /// which nodes come from (and go back to) the heap.
+  class NodePool {
+    Node* free_ = nullptr;
+    bool gone_ = false;
+
+    struct Reaper {
+      ~Reaper() {
+        auto& nodes = pool();
+        nodes.gone_ = true;
+        while (nodes.free_) {
+          Node* node = nodes.free_;
+          nodes.free_ = node->pooled;
+          delete node;
+        }
+      }
+    };
+
+   public:
+    NodePool() = default;
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    Node* take() {
+      if (!free_) {
+        // all pooled nodes were made here, so this is the first use.
+        if (!gone_) {
+          thread_local Reaper reaper;
+          (void)reaper;
+        }
+        return new Node;
+      }
+      Node* node = free_;
+      free_ = node->pooled;
+      return node;
+    }
+
+    void give(Node* node) noexcept {
+      if (gone_) {
+        delete node;
+        return;
+      }
+      node->pooled = free_;
+      free_ = node;
+    }
+  };
+
+  static NodePool& pool() noexcept {
+    static_assert(std::is_trivially_destructible<NodePool>::value,
+                  "the pool must outlive the thread's other thread_locals.");
+    thread_local NodePool nodes;
+    return nodes;
+  }
+
+  alignas(cache_line_size) std::atomic<Node*> tail_{nullptr};
+  Node* owner_ = nullptr;  // the holder's node.
+
+ public:
+  McsMutex() {}
+  McsMutex(const McsMutex&) = delete;
+  McsMutex& operator=(const McsMutex&) = delete;
+
+  /// throws std::bad_alloc only if the thread's first node can't be made,
+  /// or any once the pool is freed at thread exit.
+  void lock() {
+    Node* node = pool().take();
+    node->next.store(nullptr, std::memory_order_relaxed);
+    node->locked.store(true, std::memory_order_relaxed);
+
+    Node* prev = tail_.exchange(node, std::memory_order_acq_rel);
+    if (prev) {
+      prev->next.store(node, std::memory_order_release);
+      for (std::uint32_t spins = 0;
+           node->locked.load(std::memory_order_acquire); ++spins) {
+        if (spins < yield_after)
+          cpu_relax();
+        else
+          std::this_thread::yield();
+      }
+    }
+
+    owner_ = node;
+  }
+
+  bool try_lock() {
+    if (tail_.load(std::memory_order_relaxed)) return false;
+
+    Node* node = pool().take();
+    node->next.store(nullptr, std::memory_order_relaxed);
+
+    Node* expected = nullptr;
+    if (!tail_.compare_exchange_strong(expected, node,
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+      pool().give(node);
+      return false;
+    }
+
+    owner_ = node;
+    return true;
+  }
+
+  void unlock() noexcept {
+    Node* node = owner_;
+    Node* next = node->next.load(std::memory_order_acquire);
+    if (!next) {
+      Node* expected = node;
+      if (tail_.compare_exchange_strong(expected, nullptr,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed)) {
+        pool().give(node);
+        return;
+      }
+
+      // someone swapped in behind it, and is about to link up.
+      for (std::uint32_t spins = 0;
+           !(next = node->next.load(std::memory_order_acquire)); ++spins) {
+        if (spins < yield_after)
+          cpu_relax();
+        else
+          std::this_thread::yield();
+      }
+    }
+
+    next->locked.store(false, std::memory_order_release);
+    pool().give(node);
+  }
+
+  void acquire() { lock(); }
+  void release() noexcept { unlock(); }
+};
+
+}  // namespace tpp
+
+#endif  // TOYPP_THREADED_MCSMUTEX_HPP_
@@ -0,0 +1,208 @@
+#ifndef TOYPP_THREADED_MPMC_QUEUE_HPP_
+#define TOYPP_THREADED_MPMC_QUEUE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "hardware.hpp"
+
+namespace tpp {
+
+/**
+ * @brief A bounded lock-free multi-producer multi-consumer queue.
+ *
+ * Dmitry Vyukov's array based queue: each slot carries a sequence number
+ * telling whether it's free for the push at that position or holds the
+ * value for the pop at that position, so producers and consumers only
+ * contend on their own end's index, with a single CAS per operation,
+ * and nothing is allocated after construction.
+ *
+ * The `try_` operations fail instead of waiting when the queue is full
+ * (or empty), while `push` and `wait_pop` spin and then yield until they
+ * succeed.
+ */
+template <typename T>
+class MPMCQueue {
+ public:
+  using value_type = std::remove_cv_t<std::remove_reference_t<T>>;
+
+  static_assert(std::is_nothrow_move_constructible<value_type>::value,
+                "values are moved in and out of claimed slots, "
+                "which can't be given back.");
+
+ private:
+  struct Slot {
+    std::atomic<std::size_t> sequence;
+    alignas(value_type) unsigned char storage[sizeof(value_type)];
+
+    auto value() noexcept -> value_type&
+    {
+      return *std::launder(reinterpret_cast<value_type*>(storage));
+    }
+  };
+
+  std::size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+
+  alignas(cache_line_size) std::atomic<std::size_t> enqueue_pos_{0};
+  alignas(cache_line_size) std::atomic<std::size_t> dequeue_pos_{0};
+  char padding_[cache_line_size - sizeof(std::atomic<std::size_t>)];
+
+  static auto round_up(std::size_t capacity) noexcept -> std::size_t
+  {
+    std::size_t result = 2;
+    while (result < capacity) result <<= 1;
+    return result;
+  }
+
+  static void backoff(std::size_t& round) noexcept
+  {
+    if (round++ < 64)
+      cpu_relax();
+    else
+      std::this_thread::yield();
+  }
+
+ public:
+  /// `capacity` is rounded up to a power of two.
+  explicit MPMCQueue(std::size_t capacity)
+    : mask_(round_up(capacity) - 1)
+    , slots_(new Slot[mask_ + 1])
+  {
+    for (std::size_t i = 0; i <= mask_; ++i)
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  MPMCQueue(const MPMCQueue&) = delete;
+  MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+  ~MPMCQueue()
+  {
+    while (try_pop()) {}
+  }
+
+  [[nodiscard]] auto capacity() const noexcept -> std::size_t
+  {
+    return mask_ + 1;
+  }
+
+  /// approximate while other threads push or pop.
+  [[nodiscard]] auto size() const noexcept -> std::size_t
+  {
+    const auto dequeued = dequeue_pos_.load(std::memory_order_relaxed);
+    const auto enqueued = enqueue_pos_.load(std::memory_order_relaxed);
+    return enqueued > dequeued ? enqueued - dequeued : 0;
+  }
+
+  [[nodiscard]] auto empty() const noexcept -> bool
+  {
+    return size() == 0;
+  }
+
+  template <typename ...Args>
+  [[nodiscard]] auto try_emplace(Args&&... args) -> bool
+  {
+    if constexpr (std::is_nothrow_constructible<value_type, Args...>::value) {
+      Slot* slot = claim_push();
+      if (!slot) return false;
+
+      // a claimed slot's sequence is the position it was claimed for.
+      const auto pos = slot->sequence.load(std::memory_order_relaxed);
+      ::new (static_cast<void*>(slot->storage))
+          value_type(std::forward<Args>(args)...);
+      slot->sequence.store(pos + 1, std::memory_order_release);
+      return true;
+    } else {
+      // may throw, so it's made before claiming a slot.
+      value_type value(std::forward<Args>(args)...);
+      return try_emplace(std::move(value));
+    }
+  }
+
+  [[nodiscard]] auto try_push(const value_type& obj) -> bool
+  {
+    return try_emplace(obj);
+  }
+
+  [[nodiscard]] auto try_push(value_type&& obj) -> bool
+  {
+    return try_emplace(std::move(obj));
+  }
+
+  [[nodiscard]] auto try_pop() -> std::optional<value_type>
+  {
+    auto pos = dequeue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      Slot& slot = slots_[pos & mask_];
+      const auto sequence = slot.sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<std::intptr_t>(sequence)
+                        - static_cast<std::intptr_t>(pos + 1);
+
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          std::optional<value_type> ret{std::move(slot.value())};
+          slot.value().~value_type();
+          slot.sequence.store(pos + mask_ + 1, std::memory_order_release);
+          return ret;
+        }
+      } else if (diff < 0) {  // empty
+        return std::nullopt;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /// pushes, waiting while the queue is full.
+  void push(value_type obj)
+  {
+    std::size_t round = 0;
+    while (!try_push(std::move(obj)))
+      backoff(round);
+  }
+
+  /// pops, waiting while the queue is empty.
+  [[nodiscard]] auto wait_pop() -> value_type
+  {
+    std::size_t round = 0;
+    while (true) {
+      if (auto ret = try_pop()) return std::move(*ret);
+      backoff(round);
+    }
+  }
+
+ private:
+  /// reserves the slot for the next push, or returns null if it's full.
+  auto claim_push() noexcept -> Slot*
+  {
+    auto pos = enqueue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      Slot& slot = slots_[pos & mask_];
+      const auto sequence = slot.sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<std::intptr_t>(sequence)
+                        - static_cast<std::intptr_t>(pos);
+
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed))
+          return &slot;
+      } else if (diff < 0) {  // full
+        return nullptr;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+};
+
+}  // namespace tpp
+
+#endif  // TOYPP_THREADED_MPMC_QUEUE_HPP_
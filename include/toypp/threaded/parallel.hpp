@@ -0,0 +1,254 @@
+#ifndef TOYPP_THREADED_PARALLEL_HPP_
+#define TOYPP_THREADED_PARALLEL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../range.hpp"
+#include "threadpool.hpp"
+#include "waitgroup.hpp"
+
+namespace tpp {
+
+namespace detail {
+
+template <typename T>
+std::size_t range_count(const Range<T>& range) {
+  const T start = range.get_start();
+  const T end = range.get_end();
+  const T step = range.get_step();
+
+  T distance{};
+  T stride{};
+  if (step > T{} && start < end) {
+    distance = end - start;
+    stride = step;
+  } else if constexpr (std::is_signed<T>::value) {
+    if (!(step < T{} && end < start)) return 0;
+    distance = start - end;
+    stride = -step;
+  } else {
+    return 0;
+  }
+
+  if constexpr (std::is_integral<T>::value)
+    return static_cast<std::size_t>((distance + stride - 1) / stride);
+  else
+    return static_cast<std::size_t>(std::ceil(distance / stride));
+}
+
+template <typename T>
+T range_at(const Range<T>& range, std::size_t index) {
+  return range.get_start() + static_cast<T>(index) * range.get_step();
+}
+
+/**
+ * Runs a `Body` over the indices [0, count) on a pool.
+ *
+ * The range is first cut in one large chunk per worker plus one for the
+ * calling thread. Each chunk is then done `grain` indices at a time,
+ * and whenever some worker is idle, the remainder is split in half
+ * and the upper half is handed out as a new task (lazy binary splitting).
+ *
+ * `Body` provides `make_local()`, `step(local, begin, end)` and
+ * `finish(local, first)`, where `local` is per task state (e.g. partial sum).
+ */
+template <typename Body>
+class ParallelRun {
+  ThreadPool& pool_;
+  Body& body_;
+  std::size_t grain_;
+
+  WaitGroup pending_;
+  std::atomic<bool> failed_{false};
+  std::mutex error_mutex_;
+  std::exception_ptr error_;
+
+  void spawn(std::size_t begin, std::size_t end) {
+    pending_.add();
+    try {
+      pool_.add_task([this, begin, end] {
+        process(begin, end);
+        pending_.done();  // last touch.
+      });
+    } catch (...) {
+      pending_.done();
+      throw;
+    }
+  }
+
+  void fail(std::exception_ptr error) noexcept {
+    std::lock_guard<std::mutex> lock{error_mutex_};
+    if (!error_) error_ = std::move(error);
+    failed_.store(true, std::memory_order_relaxed);
+  }
+
+  void process(std::size_t begin, std::size_t end) noexcept {
+    try {
+      const auto first = begin;
+      auto local = body_.make_local();
+
+      bool can_split = true;
+      while (begin < end && !failed_.load(std::memory_order_relaxed)) {
+        if (can_split && end - begin > 2 * grain_ && pool_.idle_workers()) {
+          const auto middle = begin + (end - begin) / 2;
+          spawn(middle, end);
+          end = middle;
+          can_split = false;  // give the woken worker a grain to show up.
+          continue;
+        }
+
+        const auto next = std::min(end, begin + grain_);
+        body_.step(local, begin, next);
+        begin = next;
+        can_split = true;
+      }
+
+      body_.finish(std::move(local), first);
+    } catch (...) {
+      fail(std::current_exception());
+    }
+  }
+
+ public:
+  ParallelRun(ThreadPool& pool, Body& body, std::size_t grain) noexcept
+    : pool_(pool)
+    , body_(body)
+    , grain_(grain)
+  {}
+
+  void run(std::size_t count) {
+    const auto parts = pool_.workers_count() + 1;
+    if (grain_ == 0)
+      grain_ = std::max<std::size_t>(1, count / (parts * 16));
+
+    try {
+      for (std::size_t i = 1; i < parts; ++i)
+        spawn(count * i / parts, count * (i + 1) / parts);
+
+      process(0, count / parts);
+    } catch (...) {
+      fail(std::current_exception());  // couldn't spawn them all.
+    }
+
+    // help with pending tasks (ours or not) instead of blocking.
+    // the spawned ones still use this, even when spawning failed, or when
+    // a task that isn't ours throws, so nothing leaves before they're done.
+    std::exception_ptr foreign_error;
+    while (true) {
+      try {
+        pending_.wait(pool_);
+        break;
+      } catch (...) {
+        if (!foreign_error) foreign_error = std::current_exception();
+      }
+    }
+
+    if (error_)
+      std::rethrow_exception(error_);
+    if (foreign_error)
+      std::rethrow_exception(foreign_error);
+  }
+};
+
+template <typename T, typename F>
+struct ParallelForBody {
+  struct Local {};
+
+  const Range<T>& range;
+  F& fn;
+
+  Local make_local() const noexcept { return {}; }
+
+  void step(Local&, std::size_t begin, std::size_t end) {
+    for (auto i = begin; i < end; ++i)
+      fn(range_at(range, i));
+  }
+
+  void finish(Local&&, std::size_t) const noexcept {}
+};
+
+template <typename T, typename V, typename Op>
+struct ParallelReduceBody {
+  const Range<T>& range;
+  const V& init;
+  Op& op;
+
+  std::mutex mutex;
+  std::vector<std::pair<std::size_t, V>> results;  // (first index, value)
+
+  V make_local() const { return init; }
+
+  void step(V& acc, std::size_t begin, std::size_t end) {
+    for (auto i = begin; i < end; ++i)
+      acc = op(std::move(acc), range_at(range, i));
+  }
+
+  void finish(V&& acc, std::size_t first) {
+    std::lock_guard<std::mutex> lock{mutex};
+    results.emplace_back(first, std::move(acc));
+  }
+};
+
+}  // namespace detail
+
+/**
+ * @brief Calls `body(x)` for every `x` in `range`, in parallel on `pool`.
+ *
+ * The calling thread takes part in the work, and returns once it's all done.
+ * The first exception thrown by `body` is rethrown here (the rest of the
+ * work is skipped).
+ *
+ * @param grain least count of iterations a task runs between checks for
+ *              idle workers; 0 picks one based on range and pool size.
+ */
+template <typename T, typename Body>
+void parallel_for(ThreadPool& pool, const Range<T>& range, Body&& body,
+                  std::size_t grain = 0) {
+  const auto count = detail::range_count(range);
+  if (count == 0) return;
+
+  detail::ParallelForBody<T, std::remove_reference_t<Body>> for_body{
+      range, body};
+  detail::ParallelRun<decltype(for_body)>(pool, for_body, grain).run(count);
+}
+
+/**
+ * @brief Reduces `range` in parallel on `pool`.
+ *
+ * Each task folds its own part as `acc = op(acc, x)` starting from `init`,
+ * and the partial results are joined in order with `combine(a, b)`,
+ * so `combine` needs to be associative (not commutative),
+ * and `init` should be its identity.
+ */
+template <typename T, typename V, typename Op, typename Combine>
+V parallel_reduce(ThreadPool& pool, const Range<T>& range, V init,
+                  Op&& op, Combine&& combine, std::size_t grain = 0) {
+  const auto count = detail::range_count(range);
+  if (count == 0) return init;
+
+  detail::ParallelReduceBody<T, V, std::remove_reference_t<Op>> reduce_body{
+      range, init, op, {}, {}};
+  detail::ParallelRun<decltype(reduce_body)>(pool, reduce_body, grain)
+      .run(count);
+
+  auto& results = reduce_body.results;
+  std::sort(results.begin(), results.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+
+  V result = std::move(results.front().second);
+  for (auto it = results.begin() + 1; it != results.end(); ++it)
+    result = combine(std::move(result), std::move(it->second));
+  return result;
+}
+
+}  // namespace tpp
+
+#endif  // TOYPP_THREADED_PARALLEL_HPP_
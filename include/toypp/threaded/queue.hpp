@@ -5,11 +5,36 @@
 #include <optional>
 #include <mutex>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <new>
 #include <thread>
 #include <utility>
 
+#include "futex.hpp"
+#include "hardware.hpp"
+
 namespace tpp {
 
+/**
+ * @brief An unbounded thread-safe FIFO queue.
+ *
+ * It's the two-lock queue of Michael and Scott: the list always starts with
+ * a dummy node, so pushes (at the tail) and pops (at the head) each take
+ * only their own lock and don't block each other.
+ *
+ * Popped nodes aren't freed but kept for later pushes, which grab all of
+ * them at once when they run out, so once the queue has been as long as
+ * it gets, pushing and popping doesn't allocate anymore. A push takes its
+ * node and makes the element in it before taking the tail lock, which it
+ * holds only to link the node in.
+ *
+ * `wait_pop` blocks on a futex until there's an element or the queue
+ * is closed; pushes only make the wake-up syscall when someone waits.
+ * Closing doesn't stop pushes, but makes waiting pops return
+ * `std::nullopt` instead of blocking once the queue is empty.
+ */
 template <typename T>
 class MTQueue {
  public:
@@ -17,17 +42,33 @@ class MTQueue {
 
  private:
   struct Node {
-    value_type data{};
-    Node* next = nullptr;
+    std::atomic<Node*> next{nullptr};
+    alignas(value_type) unsigned char storage[sizeof(value_type)];
+
+    auto value() noexcept -> value_type&
+    {
+      return *std::launder(reinterpret_cast<value_type*>(storage));
+    }
   };
 
-  std::mutex mutex_;
-  Node* head_ = nullptr;
-  Node* tail_ = nullptr;
-  std::atomic<std::size_t> size_ = 0;
+  alignas(cache_line_size) std::mutex head_mutex_;
+  Node* head_;  // the dummy, its next holds the front.
+  Node* retired_ = nullptr;  // popped nodes, guarded by head_mutex_.
+  std::atomic<bool> has_retired_ = false;
+
+  alignas(cache_line_size) std::mutex tail_mutex_;
+  Node* tail_;
+
+  std::mutex spare_mutex_;
+  Node* spare_ = nullptr;  // nodes to push into, guarded by spare_mutex_.
+
+  alignas(cache_line_size) std::atomic<std::size_t> size_ = 0;
+  std::atomic<std::uint32_t> waiters_ = 0;
+  std::atomic<std::uint32_t> epoch_ = 0;  // futex word, bumped to wake.
+  std::atomic<bool> closed_ = false;
 
  public:
-  MTQueue() {}
+  MTQueue() : head_(new Node), tail_(head_) {}
   MTQueue(const MTQueue&) = delete;
   MTQueue(MTQueue&&) noexcept = delete;
   MTQueue& operator=(const MTQueue&) = delete;
@@ -35,6 +76,7 @@ class MTQueue {
   ~MTQueue()
   {
     clear();
+    delete head_;
   }
 
   [[nodiscard]] auto size() const noexcept -> std::size_t
@@ -42,30 +84,136 @@ class MTQueue {
     return size_;
   }
 
+  /// drops all elements, and frees the nodes kept for reuse too.
   void clear()
   {
-    std::lock_guard lk(mutex_);
-    size_ = 0;
-    tail_ = nullptr;
-    while (head_) {
-      const auto next = head_->next;
+    std::scoped_lock lk(tail_mutex_, head_mutex_, spare_mutex_);
+
+    Node* node = head_->next.load(std::memory_order_relaxed);
+    while (node) {
+      node->value().~value_type();
+      Node* next = node->next.load(std::memory_order_relaxed);
       delete head_;
-      head_ = next;
+      head_ = node;
+      node = next;
     }
+    head_->next.store(nullptr, std::memory_order_relaxed);
+    tail_ = head_;
+    size_ = 0;
+
+    delete_list(std::exchange(retired_, nullptr));
+    has_retired_.store(false, std::memory_order_relaxed);
+    delete_list(std::exchange(spare_, nullptr));
   }
 
   void push(const value_type& obj)
   {
-    Node* node = new Node{obj, nullptr};
-    std::lock_guard lk(mutex_);
-    push_node_unsafe(node);
+    emplace(obj);
   }
 
   void push(value_type&& obj)
   {
-    Node* node = new Node{std::move(obj), nullptr};
-    std::lock_guard lk(mutex_);
-    push_node_unsafe(node);
+    emplace(std::move(obj));
+  }
+
+  template <typename ...Args>
+  void emplace(Args&&... args)
+  {
+    Node* node = take_spare();
+    try {
+      ::new (static_cast<void*>(node->storage))
+          value_type(std::forward<Args>(args)...);
+    } catch (...) {
+      give_spares(node);
+      throw;
+    }
+
+    {
+      std::lock_guard lk(tail_mutex_);
+      // counted first, so a racing pop can't make it go below zero.
+      ++size_;
+      tail_->next.store(node, std::memory_order_release);
+      tail_ = node;
+    }
+
+    notify_waiters(false);
+  }
+
+  /// pushes all of [first, last), linking them in under a single
+  /// acquisition of the tail lock.
+  /// if copying an element throws, none of them is pushed.
+  template <typename InputIt>
+  void push_range(InputIt first, InputIt last)
+  {
+    using category =
+        typename std::iterator_traits<InputIt>::iterator_category;
+
+    Node* spares = nullptr;  // taken at once, if the count is known.
+    if constexpr (std::is_base_of<std::forward_iterator_tag, category>::value)
+      spares = take_spares(
+          static_cast<std::size_t>(std::distance(first, last)));
+
+    std::size_t count = 0;
+    Node* chain = nullptr;
+    Node* chain_tail = nullptr;
+
+    try {
+      for (; first != last; ++first, ++count) {
+        Node* node = spares;
+        if (node) {
+          spares = node->next.load(std::memory_order_relaxed);
+          node->next.store(nullptr, std::memory_order_relaxed);
+        } else {
+          node = take_spare();
+        }
+
+        try {
+          ::new (static_cast<void*>(node->storage)) value_type(*first);
+        } catch (...) {
+          node->next.store(spares, std::memory_order_relaxed);
+          spares = node;
+          throw;
+        }
+
+        if (chain_tail)
+          chain_tail->next.store(node, std::memory_order_relaxed);
+        else
+          chain = node;
+        chain_tail = node;
+      }
+    } catch (...) {
+      while (chain) {
+        Node* next = chain->next.load(std::memory_order_relaxed);
+        chain->value().~value_type();
+        chain->next.store(spares, std::memory_order_relaxed);
+        spares = std::exchange(chain, next);
+      }
+      give_spares(spares);
+      throw;
+    }
+
+    if (!chain) return;
+
+    {
+      std::lock_guard lk(tail_mutex_);
+      size_ += count;
+      tail_->next.store(chain, std::memory_order_release);
+      tail_ = chain_tail;
+    }
+
+    notify_waiters(count > 1);
+  }
+
+  /// wakes all waiting pops; they return std::nullopt once it's empty.
+  void close()
+  {
+    closed_ = true;
+    notify_waiters(true);
+  }
+
+  [[nodiscard]] auto closed() const noexcept -> bool
+  {
+    return closed_;
   }
 
   [[nodiscard]] auto pop() -> std::optional<value_type>
@@ -74,40 +222,194 @@ class MTQueue {
       return std::nullopt;
     }
 
-    std::optional<value_type> ret;
+    std::lock_guard lk(head_mutex_);
+    Node* front = head_->next.load(std::memory_order_acquire);
+    if (!front) {  // empty
+      return std::nullopt;
+    }
+
+    std::optional<value_type> ret{std::move(front->value())};
+    front->value().~value_type();  // it's the new dummy.
 
-    Node* node_to_delete = nullptr;
-    {
-      std::lock_guard lk(mutex_);
-      if (!head_) {  // empty
-        return std::nullopt;
-      }
+    head_->next.store(retired_, std::memory_order_relaxed);
+    retired_ = std::exchange(head_, front);
+    has_retired_.store(true, std::memory_order_relaxed);
+    --size_;
 
-      ret = std::move(head_->data);
-      node_to_delete = head_;
-      head_ = head_->next;
-      if (!head_) {  // it was the last node
-        tail_ = nullptr;
+    return ret;
+  }
+
+  /// moves up to `max` elements to `out` under a single lock acquisition,
+  /// and returns how many it did.
+  template <typename OutputIt>
+  auto pop_bulk(OutputIt out, std::size_t max) -> std::size_t
+  {
+    if (max == 0 || size_ == 0) {  // empty
+      return 0;
+    }
+
+    std::lock_guard lk(head_mutex_);
+    Node* const first = head_;
+    Node* last = nullptr;  // last one to retire.
+    std::size_t count = 0;
+
+    // retires the old dummies all at once, also if moving one out throws.
+    auto retire = [&] {
+      if (!last) return;
+      last->next.store(retired_, std::memory_order_relaxed);
+      retired_ = first;
+      has_retired_.store(true, std::memory_order_relaxed);
+      size_ -= count;
+    };
+
+    try {
+      while (count < max) {
+        Node* front = head_->next.load(std::memory_order_acquire);
+        if (!front) break;
+
+        *out = std::move(front->value());
+        ++out;
+        front->value().~value_type();  // it's the new dummy.
+
+        last = std::exchange(head_, front);
+        ++count;
       }
-      --size_;
+    } catch (...) {
+      retire();
+      throw;
     }
-    delete node_to_delete;
 
-    return ret;
+    retire();
+    return count;
+  }
+
+  /// pops, waiting for an element if it's empty.
+  /// returns std::nullopt only if the queue is closed and empty.
+  [[nodiscard]] auto wait_pop() -> std::optional<value_type>
+  {
+    for (std::size_t round = 0; true; ++round) {
+      if (auto ret = pop()) return ret;
+      if (closed_) return pop();
+      if (backoff(round)) continue;
+
+      const auto epoch = epoch_.load(std::memory_order_acquire);
+      if (!start_waiting()) continue;
+      futex_wait(epoch_, epoch);
+      --waiters_;
+    }
+  }
+
+  /// like wait_pop, but gives up with std::nullopt after `timeout`.
+  template <typename Rep, typename Period>
+  [[nodiscard]] auto wait_pop_for(
+      const std::chrono::duration<Rep, Period>& timeout)
+      -> std::optional<value_type>
+  {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (std::size_t round = 0; true; ++round) {
+      if (auto ret = pop()) return ret;
+      if (closed_) return pop();
+      if (backoff(round)) continue;
+
+      const auto left = deadline - std::chrono::steady_clock::now();
+      if (left <= left.zero()) return std::nullopt;
+
+      const auto epoch = epoch_.load(std::memory_order_acquire);
+      if (!start_waiting()) continue;
+      futex_wait_for(
+          epoch_, epoch,
+          std::chrono::duration_cast<std::chrono::nanoseconds>(left));
+      --waiters_;
+    }
   }
 
  private:
-  void push_node_unsafe(Node* node)
+  /// spins a little before blocking, as an element is often just a moment
+  /// away, and a futex sleep costs a syscall on both sides.
+  static auto backoff(std::size_t round) noexcept -> bool
   {
-    if (!tail_) {  // empty
-      head_ = tail_ = node;
-      ++size_;
-      return;
+    if (round < 16) {
+      cpu_relax();
+      return true;
+    }
+    if (round < 32) {
+      std::this_thread::yield();
+      return true;
+    }
+    return false;
+  }
+
+  /// registers a waiter, unless an element or close() slipped in meanwhile.
+  /// pairs with notify_waiters: either the pusher sees the waiter,
+  /// or the waiter sees the new size.
+  auto start_waiting() noexcept -> bool
+  {
+    ++waiters_;
+    if (size_ != 0 || closed_) {
+      --waiters_;
+      return false;
+    }
+    return true;
+  }
+
+  void notify_waiters(bool all) noexcept
+  {
+    if (waiters_ == 0) return;
+
+    epoch_.fetch_add(1, std::memory_order_release);
+    if (all)
+      futex_wake_all(epoch_);
+    else
+      futex_wake_one(epoch_);
+  }
+
+  /// takes up to `max` nodes to push into, as a list,
+  /// refilling the spares from the popped ones.
+  auto take_spares(std::size_t max) -> Node*
+  {
+    std::lock_guard lk(spare_mutex_);
+    if (!spare_ && has_retired_.load(std::memory_order_relaxed)) {
+      std::lock_guard head_lk(head_mutex_);
+      spare_ = std::exchange(retired_, nullptr);
+      has_retired_.store(false, std::memory_order_relaxed);
+    }
+
+    Node* const first = spare_;
+    Node* last = nullptr;
+    for (; spare_ && max; --max) {
+      last = spare_;
+      spare_ = spare_->next.load(std::memory_order_relaxed);
     }
+    if (last) last->next.store(nullptr, std::memory_order_relaxed);
+    return last ? first : nullptr;
+  }
+
+  auto take_spare() -> Node*
+  {
+    Node* node = take_spares(1);
+    return node ? node : new Node;
+  }
+
+  /// keeps a list of unused nodes for later pushes.
+  void give_spares(Node* first) noexcept
+  {
+    if (!first) return;
 
-    tail_->next = node;
-    tail_ = node;
-    ++size_;
+    Node* last = first;
+    while (Node* next = last->next.load(std::memory_order_relaxed)) {
+      last = next;
+    }
+
+    std::lock_guard lk(spare_mutex_);
+    last->next.store(spare_, std::memory_order_relaxed);
+    spare_ = first;
+  }
+
+  static void delete_list(Node* node) noexcept
+  {
+    while (node) {
+      delete std::exchange(node, node->next.load(std::memory_order_relaxed));
+    }
   }
 };
 
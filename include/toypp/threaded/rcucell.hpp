@@ -0,0 +1,251 @@
+#ifndef TOYPP_THREADED_RCUCELL_HPP_
+#define TOYPP_THREADED_RCUCELL_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "asymmetric_fence.hpp"
+#include "hardware.hpp"
+
+namespace tpp {
+
+/**
+ * @brief Publishes versions of a value to many readers, read-copy-update
+ *        style.
+ *
+ * Each version lives in its own allocation and the cell points at the
+ * latest one. Writers swap in a new version and never wait for readers,
+ * readers never wait at all: a read only stores the current epoch in the
+ * reader's own padded slot (so readers share no cache line they write to),
+ * loads the pointer, and clears its slot once done.
+ *
+ * Replaced versions are retired at the epoch they were replaced in, and
+ * reclaimed (passed to the reclamation callback if there's one, and freed)
+ * once no reader is still in a read started before that epoch. That's
+ * checked on every publish and by `reclaim`, so a version stays around
+ * as long as some slow reader might be looking at it.
+ *
+ * The reader slots are fixed at construction, each `Reader` takes one for
+ * its lifetime. Writers are serialized on a mutex. The callback (which
+ * mustn't throw) also gets the versions left when the cell is destroyed.
+ */
+template <typename T>
+class RcuCell {
+ public:
+  using value_type = std::remove_cv_t<std::remove_reference_t<T>>;
+  using reclaim_type = std::function<void(value_type&&)>;
+
+ private:
+  struct Version {
+    value_type value;
+    std::uint64_t retired_at = 0;
+
+    template <typename ...Args>
+    explicit Version(Args&&... args) : value(std::forward<Args>(args)...) {}
+  };
+
+  struct alignas(cache_line_size) ReaderSlot {
+    std::atomic<std::uint64_t> epoch{0};  // 0 while not reading.
+    std::atomic<bool> claimed{false};
+  };
+
+  alignas(cache_line_size) std::atomic<Version*> current_;
+  std::atomic<std::uint64_t> epoch_{1};
+
+  std::unique_ptr<ReaderSlot[]> slots_;
+  std::size_t slots_count_;
+
+  std::mutex writer_mutex_;
+  std::vector<Version*> retired_;  // oldest first, guarded by writer_mutex_.
+  reclaim_type on_reclaim_;
+
+ public:
+  class Reader;
+
+  /// pins a version for as long as it lives.
+  class ReadGuard {
+    ReaderSlot* slot_;
+    const value_type* value_;
+
+    friend class Reader;
+
+    ReadGuard(ReaderSlot* slot, const value_type* value) noexcept
+      : slot_(slot)
+      , value_(value)
+    {}
+
+   public:
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+    ~ReadGuard()
+    {
+      slot_->epoch.store(0, std::memory_order_release);
+    }
+
+    [[nodiscard]] auto get() const noexcept -> const value_type&
+    {
+      return *value_;
+    }
+
+    [[nodiscard]] auto operator*() const noexcept -> const value_type&
+    {
+      return *value_;
+    }
+
+    [[nodiscard]] auto operator->() const noexcept -> const value_type*
+    {
+      return value_;
+    }
+  };
+
+  /// a reader slot, to be used by one thread at a time,
+  /// with at most one ReadGuard alive at a time.
+  class Reader {
+    RcuCell* cell_;
+    ReaderSlot* slot_;
+
+   public:
+    /// throws std::length_error if all reader slots are taken.
+    explicit Reader(RcuCell& cell) : cell_(&cell), slot_(cell.claim_slot()) {}
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+    ~Reader()
+    {
+      slot_->claimed.store(false, std::memory_order_release);
+    }
+
+    [[nodiscard]] auto read() noexcept -> ReadGuard
+    {
+      // a writer that doesn't see the epoch in the slot (which the light
+      // fence pairs with its heavy one for) has published before this
+      // loads the pointer, so this doesn't get what it reclaims.
+      const auto epoch = cell_->epoch_.load(std::memory_order_acquire);
+      slot_->epoch.store(epoch, std::memory_order_relaxed);
+      light_fence();
+      const Version* version =
+          cell_->current_.load(std::memory_order_acquire);
+      return ReadGuard(slot_, &version->value);
+    }
+  };
+
+  /// `max_readers` is how many Reader objects can exist at once.
+  explicit RcuCell(value_type value, std::size_t max_readers = 64,
+                   reclaim_type on_reclaim = {})
+    : current_(new Version(std::move(value)))
+    , slots_(new ReaderSlot[max_readers])
+    , slots_count_(max_readers)
+    , on_reclaim_(std::move(on_reclaim))
+  {
+    (void)detail::membarrier_registered();  // not on the first publish.
+  }
+
+  RcuCell(const RcuCell&) = delete;
+  RcuCell& operator=(const RcuCell&) = delete;
+
+  /// there must be no reads going on anymore.
+  ~RcuCell()
+  {
+    for (Version* version : retired_) destroy(version);
+    destroy(current_.load(std::memory_order_relaxed));
+  }
+
+  /// makes `value` the current version.
+  void publish(value_type value)
+  {
+    emplace(std::move(value));
+  }
+
+  template <typename ...Args>
+  void emplace(Args&&... args)
+  {
+    std::unique_ptr<Version> version{
+        new Version(std::forward<Args>(args)...)};
+
+    std::lock_guard lk(writer_mutex_);
+    retired_.reserve(retired_.size() + 1);
+    replace_unsafe(version.release());
+  }
+
+  /// publishes a copy of the current version as modified by `fn`.
+  template <typename F>
+  void update(F&& fn)
+  {
+    std::lock_guard lk(writer_mutex_);
+    std::unique_ptr<Version> version{
+        new Version(current_.load(std::memory_order_relaxed)->value)};
+    std::forward<F>(fn)(version->value);
+
+    retired_.reserve(retired_.size() + 1);
+    replace_unsafe(version.release());
+  }
+
+  /// reclaims the retired versions no reader can see anymore,
+  /// and returns how many are still waiting for readers.
+  auto reclaim() -> std::size_t
+  {
+    std::lock_guard lk(writer_mutex_);
+    reclaim_unsafe();
+    return retired_.size();
+  }
+
+ private:
+  auto claim_slot() -> ReaderSlot*
+  {
+    for (std::size_t i = 0; i < slots_count_; ++i) {
+      bool expected = false;
+      if (slots_[i].claimed.compare_exchange_strong(
+              expected, true, std::memory_order_acquire))
+        return &slots_[i];
+    }
+    throw std::length_error("tpp::RcuCell: all reader slots are taken.");
+  }
+
+  void replace_unsafe(Version* version)
+  {
+    Version* old = current_.exchange(version, std::memory_order_acq_rel);
+    old->retired_at = epoch_.fetch_add(1, std::memory_order_acq_rel) + 1;
+    retired_.push_back(old);
+    reclaim_unsafe();
+  }
+
+  void reclaim_unsafe()
+  {
+    if (retired_.empty()) return;
+
+    // after this, any reader not seen in a slot will load the latest one.
+    heavy_fence();
+
+    auto oldest_read = ~std::uint64_t{0};
+    for (std::size_t i = 0; i < slots_count_; ++i) {
+      const auto epoch = slots_[i].epoch.load(std::memory_order_acquire);
+      if (epoch != 0 && epoch < oldest_read) oldest_read = epoch;
+    }
+
+    // retired in order, so those a reader might see are all at the end.
+    std::size_t count = 0;
+    while (count < retired_.size()
+           && retired_[count]->retired_at <= oldest_read)
+      ++count;
+
+    for (std::size_t i = 0; i < count; ++i) destroy(retired_[i]);
+    retired_.erase(retired_.begin(), retired_.begin() + count);
+  }
+
+  void destroy(Version* version) noexcept
+  {
+    std::unique_ptr<Version> owner{version};
+    if (on_reclaim_) on_reclaim_(std::move(version->value));
+  }
+};
+
+}  // namespace tpp
+
+#endif  // TOYPP_THREADED_RCUCELL_HPP_
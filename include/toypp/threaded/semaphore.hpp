@@ -0,0 +1,130 @@
+#ifndef TOYPP_THREADED_SEMAPHORE_HPP_
+#define TOYPP_THREADED_SEMAPHORE_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "futex.hpp"
+#include "hardware.hpp"
+
+namespace tpp {
+
+/**
+ * @brief A counting semaphore that sleeps on a futex while it waits.
+ *
+ * The count itself is the futex word. Taking permits that are there is a
+ * single CAS, and giving them back a single add, which makes the wake-up
+ * syscall only if someone is waiting. A waiter spins only briefly before
+ * it sleeps, as permits are usually held for a while (e.g. for I/O).
+ *
+ * Permits can be taken and given back in bulk; the bulk waiters are
+ * counted too, as a single wake-up could otherwise go to a waiter wanting
+ * more than there is, while one that would be content sleeps on.
+ */
+class CountingSemaphore {
+  static constexpr std::uint32_t spins = 64;
+
+  std::atomic<std::uint32_t> count_;
+  std::atomic<std::uint32_t> waiters_{0};
+  std::atomic<std::uint32_t> bulk_waiters_{0};
+
+ public:
+  explicit CountingSemaphore(std::uint32_t count = 0) : count_(count) {}
+  CountingSemaphore(const CountingSemaphore&) = delete;
+  CountingSemaphore& operator=(const CountingSemaphore&) = delete;
+
+  /// permits available right now.
+  [[nodiscard]] auto count() const noexcept -> std::uint32_t
+  {
+    return count_.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] auto try_acquire(std::uint32_t n = 1) noexcept -> bool
+  {
+    auto count = count_.load(std::memory_order_relaxed);
+    while (count >= n) {
+      if (count_.compare_exchange_weak(count, count - n,
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed))
+        return true;
+    }
+    return false;
+  }
+
+  /// takes `n` permits, waiting until there are that many.
+  void acquire(std::uint32_t n = 1) noexcept
+  {
+    for (std::uint32_t round = 0; !try_acquire(n); ++round) {
+      if (round < spins) {
+        cpu_relax();
+        continue;
+      }
+
+      std::uint32_t count = 0;
+      if (start_waiting(count, n))
+        futex_wait(count_, count);
+      stop_waiting(n);
+    }
+  }
+
+  /// like acquire, but gives up after `timeout`; returns whether it got them.
+  template <typename Rep, typename Period>
+  [[nodiscard]] auto try_acquire_for(
+      const std::chrono::duration<Rep, Period>& timeout,
+      std::uint32_t n = 1) noexcept -> bool
+  {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (std::uint32_t round = 0; !try_acquire(n); ++round) {
+      if (round < spins) {
+        cpu_relax();
+        continue;
+      }
+
+      const auto left = deadline - std::chrono::steady_clock::now();
+      if (left <= left.zero()) return false;
+
+      std::uint32_t count = 0;
+      if (start_waiting(count, n))
+        futex_wait_for(
+            count_, count,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(left));
+      stop_waiting(n);
+    }
+    return true;
+  }
+
+  /// gives back (or adds) `n` permits, waking waiters if there are any.
+  void release(std::uint32_t n = 1) noexcept
+  {
+    count_.fetch_add(n, std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_seq_cst) == 0) return;
+
+    if (n == 1 && bulk_waiters_.load(std::memory_order_relaxed) == 0)
+      futex_wake_one(count_);
+    else
+      futex_wake_all(count_);
+  }
+
+ private:
+  /// registers a waiter, and returns whether it should still sleep, i.e.
+  /// the `count` it read is still too low. pairs with release: either it
+  /// sees the waiter, or this sees the new count.
+  auto start_waiting(std::uint32_t& count, std::uint32_t n) noexcept -> bool
+  {
+    if (n > 1) bulk_waiters_.fetch_add(1, std::memory_order_relaxed);
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    count = count_.load(std::memory_order_seq_cst);
+    return count < n;
+  }
+
+  void stop_waiting(std::uint32_t n) noexcept
+  {
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+    if (n > 1) bulk_waiters_.fetch_sub(1, std::memory_order_relaxed);
+  }
+};
+
+}  // namespace tpp
+
+#endif  // TOYPP_THREADED_SEMAPHORE_HPP_
@@ -2,25 +2,120 @@
 #define TOYPP_THREADED_SPINMUTEX_HPP_
 
 #include <atomic>
+#include <cstdint>
+
+#include "hardware.hpp"
 
 namespace tpp {
 
-class SpinMutex {
+/// contention counters of a spin lock, see BasicSpinMutex.
+struct SpinMutexStats {
+  std::uint64_t acquisitions = 0;  // successful lock / try_lock calls.
+  std::uint64_t contended = 0;     // lock calls that found it locked.
+  std::uint64_t spins = 0;         // backoff rounds spent waiting.
+};
+
+namespace detail {
+
+template <bool Enabled>
+class SpinCounters {
+ protected:
+  void count(bool, std::uint64_t) noexcept {}
+};
+
+// only the lock holder writes them, so they're plain relaxed load-stores,
+// on their own cache line to leave the waiters' one alone.
+template <>
+class SpinCounters<true> {
+  struct alignas(cache_line_size) Counters {
+    std::atomic<std::uint64_t> acquisitions{0};
+    std::atomic<std::uint64_t> contended{0};
+    std::atomic<std::uint64_t> spins{0};
+  } counters_;
+
+  static void add(std::atomic<std::uint64_t>& counter,
+                  std::uint64_t value) noexcept {
+    counter.store(counter.load(std::memory_order_relaxed) + value,
+                  std::memory_order_relaxed);
+  }
+
+ protected:
+  void count(bool contended, std::uint64_t spins) noexcept {
+    add(counters_.acquisitions, 1);
+    if (contended) {
+      add(counters_.contended, 1);
+      add(counters_.spins, spins);
+    }
+  }
+
+ public:
+  SpinMutexStats stats() const noexcept {
+    SpinMutexStats result;
+    result.acquisitions =
+        counters_.acquisitions.load(std::memory_order_relaxed);
+    result.contended = counters_.contended.load(std::memory_order_relaxed);
+    result.spins = counters_.spins.load(std::memory_order_relaxed);
+    return result;
+  }
+};
+
+}  // namespace detail
+
+/**
+ * @brief A test-and-test-and-set spin lock with exponential backoff.
+ *
+ * Waiters spin reading the flag, which stays in their cache until it's
+ * released, and only then try to take it, backing off exponentially in
+ * between (see SpinBackoff).
+ *
+ * It's Lockable, so it works with `std::lock_guard` and friends;
+ * `acquire` and `release` are the same as `lock` and `unlock`.
+ * With `Stats` it also counts acquisitions and contention, see `stats()`.
+ */
+template <bool Stats = false>
+class BasicSpinMutex : public detail::SpinCounters<Stats> {
   std::atomic<bool> flag_{false};
 
  public:
-  SpinMutex() {}
-  SpinMutex(const SpinMutex&) = delete;
+  BasicSpinMutex() {}
+  BasicSpinMutex(const BasicSpinMutex&) = delete;
+  BasicSpinMutex& operator=(const BasicSpinMutex&) = delete;
+
+  void lock() noexcept {
+    if (!flag_.exchange(true, std::memory_order_acquire)) {
+      this->count(false, 0);
+      return;
+    }
+
+    std::uint64_t spins = 0;
+    SpinBackoff backoff;
+    do {
+      while (flag_.load(std::memory_order_relaxed)) {
+        ++spins;
+        backoff();
+      }
+    } while (flag_.exchange(true, std::memory_order_acquire));
 
-  void acquire() noexcept {
-    bool current = false;
-    while (!flag_.compare_exchange_weak(current, true))
-      current = false;
+    this->count(true, spins);
   }
 
-  void release() noexcept { flag_.store(false); }
+  bool try_lock() noexcept {
+    if (flag_.load(std::memory_order_relaxed)
+        || flag_.exchange(true, std::memory_order_acquire))
+      return false;
+
+    this->count(false, 0);
+    return true;
+  }
+
+  void unlock() noexcept { flag_.store(false, std::memory_order_release); }
+
+  void acquire() noexcept { lock(); }
+  void release() noexcept { unlock(); }
 };
 
+using SpinMutex = BasicSpinMutex<false>;
+
 }  // namespace tpp
 
 #endif  // TOYPP_THREADED_SPINMUTEX_HPP_
@@ -1,30 +1,23 @@
 #ifndef TOYPP_THREADED_SPINSEMAPHORE_HPP_
 #define TOYPP_THREADED_SPINSEMAPHORE_HPP_
 
-#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <thread>
 
+#include "semaphore.hpp"
+
 namespace tpp {
 
+/// a CountingSemaphore starting with `max` permits (the number of cpus by
+/// default). it no longer just spins, the name stays for compatibility.
 template <std::size_t MaxCount = 0>
-class SpinSemaphore {
+class SpinSemaphore : public CountingSemaphore {
  public:
   static const std::size_t max;
 
- private:
-  std::atomic<int> count_;
-
- public:
-  SpinSemaphore() : count_(max) {}
+  SpinSemaphore() : CountingSemaphore(static_cast<std::uint32_t>(max)) {}
   SpinSemaphore(const SpinSemaphore&) = delete;
-
-  void acquire() noexcept {
-    auto current = count_.load();
-    while ((current += (current == 0)) // if current == 0: current = 1
-          && !count_.compare_exchange_strong(current, current-1));
-  }
-
-  void release() noexcept { count_.fetch_add(1); }
 };
 
 template <std::size_t MaxCount>
@@ -0,0 +1,110 @@
+#ifndef TOYPP_THREADED_SPINSHAREDMUTEX_HPP_
+#define TOYPP_THREADED_SPINSHAREDMUTEX_HPP_
+
+#include <atomic>
+#include <cstdint>
+
+#include "hardware.hpp"
+
+namespace tpp {
+
+/**
+ * @brief A reader-writer spin lock.
+ *
+ * A single atomic word holds whether a writer has it, whether one waits
+ * for it, and how many readers have it. Writers and readers wait the same
+ * way as in SpinMutex, reading the word until it looks free, and backing
+ * off in between (see SpinBackoff).
+ *
+ * With `PreferWriters`, a waiting writer keeps new readers out, so a steady
+ * stream of readers can't starve it; without, readers only wait for a
+ * writer that holds it, which gets the most reading done but can leave
+ * writers waiting indefinitely.
+ *
+ * It's SharedLockable, so it works with `std::shared_lock` as well as with
+ * `std::lock_guard` and friends; `acquire` and `release` are exclusive,
+ * as in SpinMutex.
+ */
+template <bool PreferWriters = true>
+class BasicSpinSharedMutex {
+  static constexpr std::uint32_t writer = 1;
+  static constexpr std::uint32_t writer_waiting = 2;
+  static constexpr std::uint32_t reader = 4;  // one reader's increment.
+
+  std::atomic<std::uint32_t> state_{0};
+
+  static constexpr bool keeps_readers_out(std::uint32_t state) noexcept {
+    return (state & writer)
+           || (PreferWriters && (state & writer_waiting));
+  }
+
+ public:
+  BasicSpinSharedMutex() {}
+  BasicSpinSharedMutex(const BasicSpinSharedMutex&) = delete;
+  BasicSpinSharedMutex& operator=(const BasicSpinSharedMutex&) = delete;
+
+  void lock() noexcept {
+    if (try_lock()) return;
+
+    SpinBackoff backoff;
+    while (true) {
+      auto state = state_.load(std::memory_order_relaxed);
+      if ((state & ~writer_waiting) == 0) {
+        // taking it also clears the flag, other waiting writers set it again.
+        if (state_.compare_exchange_weak(state, writer,
+                                         std::memory_order_acquire,
+                                         std::memory_order_relaxed))
+          return;
+        continue;
+      }
+
+      if (PreferWriters && !(state & writer_waiting))
+        state_.fetch_or(writer_waiting, std::memory_order_relaxed);
+      backoff();
+    }
+  }
+
+  bool try_lock() noexcept {
+    auto state = state_.load(std::memory_order_relaxed);
+    return (state & ~writer_waiting) == 0
+           && state_.compare_exchange_strong(state, writer,
+                                             std::memory_order_acquire,
+                                             std::memory_order_relaxed);
+  }
+
+  void unlock() noexcept {
+    state_.fetch_and(~writer, std::memory_order_release);
+  }
+
+  void lock_shared() noexcept {
+    SpinBackoff backoff;
+    while (!try_lock_shared()) {
+      while (keeps_readers_out(state_.load(std::memory_order_relaxed)))
+        backoff();
+    }
+  }
+
+  bool try_lock_shared() noexcept {
+    auto state = state_.load(std::memory_order_relaxed);
+    while (!keeps_readers_out(state)) {
+      if (state_.compare_exchange_weak(state, state + reader,
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed))
+        return true;
+    }
+    return false;
+  }
+
+  void unlock_shared() noexcept {
+    state_.fetch_sub(reader, std::memory_order_release);
+  }
+
+  void acquire() noexcept { lock(); }
+  void release() noexcept { unlock(); }
+};
+
+using SpinSharedMutex = BasicSpinSharedMutex<true>;
+
+}  // namespace tpp
+
+#endif  // TOYPP_THREADED_SPINSHAREDMUTEX_HPP_
@@ -0,0 +1,215 @@
+#ifndef TOYPP_THREADED_SPSC_QUEUE_HPP_
+#define TOYPP_THREADED_SPSC_QUEUE_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "hardware.hpp"
+
+namespace tpp {
+
+/**
+ * @brief A wait-free single-producer single-consumer queue of `N` values.
+ *
+ * `N` has to be a power of two, so a slot is found with a mask.
+ *
+ * Push operations (`try_emplace`, `try_push`, `push_n`) can be used by only
+ * one thread at a time, pop operations (`front`, `pop`, `try_pop`, `pop_n`)
+ * by only one other thread at a time.
+ *
+ * Values live in place in a fixed array, and like `SPSCRingBuffer` head and
+ * tail only ever grow, each sitting on its own cache line next to the copy
+ * of the other one its side works with, so the two sides touch each other's
+ * line only when that copy says it's full (or empty). The batched `push_n`
+ * and `pop_n` publish their index once per batch.
+ */
+template <typename T, std::size_t N>
+class SPSCQueue {
+ public:
+  using value_type = std::remove_cv_t<std::remove_reference_t<T>>;
+
+  static_assert(N > 0, "an empty queue can't pass anything.");
+  static_assert((N & (N - 1)) == 0,
+                "N must be a power of two, for the indices to wrap around.");
+
+ private:
+  struct Slot {
+    alignas(value_type) unsigned char storage[sizeof(value_type)];
+
+    auto value() noexcept -> value_type&
+    {
+      return *std::launder(reinterpret_cast<value_type*>(storage));
+    }
+  };
+
+  // consumer side.
+  alignas(cache_line_size) std::atomic<std::size_t> head_{0};
+  std::size_t cached_tail_ = 0;
+
+  // producer side.
+  alignas(cache_line_size) std::atomic<std::size_t> tail_{0};
+  std::size_t cached_head_ = 0;
+
+  alignas(cache_line_size) Slot slots_[N];
+
+  static constexpr std::size_t mask = N - 1;
+
+ public:
+  SPSCQueue() = default;
+  SPSCQueue(const SPSCQueue&) = delete;
+  SPSCQueue(SPSCQueue&&) noexcept = delete;
+  SPSCQueue& operator=(const SPSCQueue&) = delete;
+  SPSCQueue& operator=(SPSCQueue&&) noexcept = delete;
+  ~SPSCQueue()
+  {
+    while (front()) pop();
+  }
+
+  [[nodiscard]] static constexpr auto capacity() noexcept -> std::size_t
+  {
+    return N;
+  }
+
+  /// exact only when called by one of the two sides.
+  [[nodiscard]] auto size() const noexcept -> std::size_t
+  {
+    const auto head = head_.load(std::memory_order_acquire);
+    const auto tail = tail_.load(std::memory_order_acquire);
+    return tail - head;
+  }
+
+  [[nodiscard]] auto empty() const noexcept -> bool
+  {
+    return size() == 0;
+  }
+
+  /// constructs a value in place at the back, unless it's full.
+  template <typename ...Args>
+  [[nodiscard]] auto try_emplace(Args&&... args) -> bool
+  {
+    const auto tail = tail_.load(std::memory_order_relaxed);
+    if (writable(tail, 1) == 0) {  // full
+      return false;
+    }
+
+    ::new (static_cast<void*>(slots_[tail & mask].storage))
+        value_type(std::forward<Args>(args)...);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  [[nodiscard]] auto try_push(const value_type& obj) -> bool
+  {
+    return try_emplace(obj);
+  }
+
+  [[nodiscard]] auto try_push(value_type&& obj) -> bool
+  {
+    return try_emplace(std::move(obj));
+  }
+
+  /// pushes copies of up to `count` values from `first` at once,
+  /// and returns how many it did. if copying one throws, the ones
+  /// before it are pushed nevertheless.
+  template <typename InputIt>
+  auto push_n(InputIt first, std::size_t count) -> std::size_t
+  {
+    const auto tail = tail_.load(std::memory_order_relaxed);
+    count = writable(tail, count);
+
+    std::size_t done = 0;
+    try {
+      for (; done < count; ++done, ++first)
+        ::new (static_cast<void*>(slots_[(tail + done) & mask].storage))
+            value_type(*first);
+    } catch (...) {
+      tail_.store(tail + done, std::memory_order_release);
+      throw;
+    }
+
+    tail_.store(tail + done, std::memory_order_release);
+    return done;
+  }
+
+  /// the value at the front, or null if it's empty.
+  /// it stays valid until it's popped.
+  [[nodiscard]] auto front() noexcept -> value_type*
+  {
+    const auto head = head_.load(std::memory_order_relaxed);
+    if (readable(head, 1) == 0) {  // empty
+      return nullptr;
+    }
+    return &slots_[head & mask].value();
+  }
+
+  /// drops the value at the front, which must exist (see `front`).
+  void pop() noexcept
+  {
+    const auto head = head_.load(std::memory_order_relaxed);
+    slots_[head & mask].value().~value_type();
+    head_.store(head + 1, std::memory_order_release);
+  }
+
+  [[nodiscard]] auto try_pop() -> std::optional<value_type>
+  {
+    value_type* value = front();
+    if (!value) {  // empty
+      return std::nullopt;
+    }
+
+    std::optional<value_type> ret{std::move(*value)};
+    pop();
+    return ret;
+  }
+
+  /// moves up to `max` values to `out` at once, and returns how many it did.
+  /// if moving one out throws, it stays at the front.
+  template <typename OutputIt>
+  auto pop_n(OutputIt out, std::size_t max) -> std::size_t
+  {
+    const auto head = head_.load(std::memory_order_relaxed);
+    max = readable(head, max);
+
+    std::size_t done = 0;
+    try {
+      for (; done < max; ++done) {
+        value_type& value = slots_[(head + done) & mask].value();
+        *out = std::move(value);
+        ++out;
+        value.~value_type();
+      }
+    } catch (...) {
+      head_.store(head + done, std::memory_order_release);
+      throw;
+    }
+
+    head_.store(head + done, std::memory_order_release);
+    return done;
+  }
+
+ private:
+  /// how many of `count` values can be pushed at `tail`.
+  auto writable(std::size_t tail, std::size_t count) noexcept -> std::size_t
+  {
+    if (N - (tail - cached_head_) < count)
+      cached_head_ = head_.load(std::memory_order_acquire);
+    return std::min(count, N - (tail - cached_head_));
+  }
+
+  /// how many of `count` values can be popped at `head`.
+  auto readable(std::size_t head, std::size_t count) noexcept -> std::size_t
+  {
+    if (cached_tail_ - head < count)
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+    return std::min(count, cached_tail_ - head);
+  }
+};
+
+}  // namespace tpp
+
+#endif  // TOYPP_THREADED_SPSC_QUEUE_HPP_
@@ -1,62 +1,364 @@
 #ifndef TOYPP_THREADED_SPSC_RINGBUFFER_HPP_
 #define TOYPP_THREADED_SPSC_RINGBUFFER_HPP_
 
+#include <algorithm>
 #include <atomic>
-#include <memory>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cerrno>
 #include <cstring>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "../span.hpp"
+#include "asymmetric_fence.hpp"
+#include "futex.hpp"
+#include "hardware.hpp"
 
 namespace tpp {
 
+namespace detail {
+
+inline auto page_size() noexcept -> std::size_t
+{
+#if defined(__linux__)
+  return static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#else
+  return 4096;
+#endif
+}
+
+/// maps the same `size` bytes twice in a row, so the byte at `ptr + i` is
+/// also at `ptr + size + i`. `size` must be a multiple of the page size.
+inline auto map_mirrored(std::size_t size) -> char*
+{
+#if defined(__linux__)
+  const int fd = memfd_create("tpp-ring", MFD_CLOEXEC);
+  if (fd == -1)
+    throw std::system_error(errno, std::system_category(), "memfd_create");
+
+  void* addr = MAP_FAILED;
+  auto fail = [&](const char* what) {
+    const int error = errno;
+    if (addr != MAP_FAILED) munmap(addr, 2 * size);
+    close(fd);
+    throw std::system_error(error, std::system_category(), what);
+  };
+
+  if (ftruncate(fd, static_cast<off_t>(size)) == -1) fail("ftruncate");
+
+  // reserves both halves first, so nothing else can be mapped in between.
+  addr = mmap(nullptr, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS,
+              -1, 0);
+  if (addr == MAP_FAILED) fail("mmap");
+
+  char* const ptr = static_cast<char*>(addr);
+  for (char* half : {ptr, ptr + size}) {
+    if (mmap(half, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+             fd, 0) == MAP_FAILED)
+      fail("mmap");
+  }
+
+  close(fd);  // the mappings keep the memory alive.
+  return ptr;
+#else
+  (void)size;
+  throw std::system_error(std::make_error_code(std::errc::not_supported),
+                          "mirrored ring buffer");
+#endif
+}
+
+inline void unmap_mirrored(char* ptr, std::size_t size) noexcept
+{
+#if defined(__linux__)
+  munmap(ptr, 2 * size);
+#else
+  (void)ptr;
+  (void)size;
+#endif
+}
+
+}  // namespace detail
+
 /**
- * Thread-Safe wait-free single-procucer-single-consumer continugous ring buffer of bytes.
- * 
+ * Thread-Safe wait-free single-producer-single-consumer ring buffer of bytes.
+ *
  * `read` (consumer) can be used by only one thread at a time.
  * `write` (producer) can be used by only one thread at a time.
- * `read` and `write` can be used in two different threads simultanously.
+ * `read` and `write` can be used in two different threads simultaneously.
+ *
+ * The size is rounded up to a power of two, all of which can be filled.
+ * Head and tail only ever grow (wrapping around along with `std::size_t`)
+ * and are masked into the buffer, so full and empty can't be mixed up.
+ * Each side also keeps a copy of the other side's index and only reloads
+ * it when that copy says there's no room (or data), so the two sides touch
+ * each other's cache line only about once per lap instead of every call.
+ *
+ * Besides copying through `read` and `write`, each side can work in place:
+ * the producer fills the span from `prepare_write` and publishes it with
+ * `commit_write`, the consumer parses the span from `peek_read` and frees
+ * it with `consume`. These spans end at the end of the buffer, so data that
+ * wraps around takes a second round to get at.
+ *
+ * Unless it's mirrored (linux only): then the buffer is mapped twice back
+ * to back in virtual memory, so whatever's readable or writable is a single
+ * span, wrapped or not, and `read`/`write` copy it in one go. Its size is
+ * then rounded up to a multiple of the page size as well.
+ *
+ * A consumer that has nothing to do can block in `wait_readable` instead of
+ * polling: it spins a little, then parks on a futex, after announcing so on
+ * the producer's cache line. The producer checks that flag as it publishes,
+ * and makes the wake-up syscall only if it's set. The handshake needs a
+ * full fence on both sides, which is an asymmetric one (see `heavy_fence`),
+ * so the producer pays only for a plain load while nobody's parked.
  */
 class SPSCRingBuffer {
-  std::size_t buffer_size_ = 0;
-  std::unique_ptr<char[]> buffer_;
-  std::atomic<std::size_t> head_{0};
-  std::atomic<std::size_t> tail_{0};
+  bool mirrored_;
+  std::size_t mask_;
+  char* buffer_;
+
+  // consumer side.
+  alignas(cache_line_size) std::atomic<std::size_t> head_{0};
+  std::size_t cached_tail_ = 0;
+
+  // producer side.
+  alignas(cache_line_size) std::atomic<std::size_t> tail_{0};
+  std::size_t cached_head_ = 0;
+  std::atomic<std::uint32_t> parked_{0};  // futex word, set by the consumer.
+
+  char padding_[cache_line_size - sizeof(std::atomic<std::size_t>)
+                - sizeof(std::size_t) - sizeof(std::atomic<std::uint32_t>)];
+
+  static auto round_up(std::size_t size) noexcept -> std::size_t
+  {
+    std::size_t result = 1;
+    while (result < size) result <<= 1;
+    return result;
+  }
 
  public:
-  SPSCRingBuffer(std::size_t size)
-    : buffer_size_(size)
-    , buffer_(std::make_unique<char[]>(size)) 
-  {}
+  /// throws std::system_error if it's `mirrored` but can't be mapped so.
+  SPSCRingBuffer(std::size_t size, bool mirrored = false)
+    : mirrored_(mirrored)
+    , mask_(round_up(mirrored ? std::max(size, detail::page_size()) : size)
+            - 1)
+    , buffer_(mirrored ? detail::map_mirrored(capacity())
+                       : new char[capacity()])
+  {
+    (void)detail::membarrier_registered();  // not on the first wait.
+  }
   SPSCRingBuffer(const SPSCRingBuffer&) = delete;
   SPSCRingBuffer(SPSCRingBuffer&&) noexcept = delete;
   SPSCRingBuffer& operator=(const SPSCRingBuffer&) = delete;
   SPSCRingBuffer& operator=(SPSCRingBuffer&&) noexcept = delete;
-  ~SPSCRingBuffer() = default;
+  ~SPSCRingBuffer()
+  {
+    if (mirrored_)
+      detail::unmap_mirrored(buffer_, capacity());
+    else
+      delete[] buffer_;
+  }
+
+  [[nodiscard]] auto capacity() const noexcept -> std::size_t
+  {
+    return mask_ + 1;
+  }
+
+  [[nodiscard]] auto mirrored() const noexcept -> bool
+  {
+    return mirrored_;
+  }
+
+  /// readable bytes; exact only when called by one of the two sides.
+  [[nodiscard]] auto size() const noexcept -> std::size_t
+  {
+    const auto head = head_.load(std::memory_order_acquire);
+    const auto tail = tail_.load(std::memory_order_acquire);
+    return tail - head;
+  }
 
+  /// reads up to `size` bytes into `ptr`, returns how many it did.
   auto read(char* ptr, std::size_t size) -> std::size_t
   {
-    const auto head = head_.load();
-    const auto tail = tail_.load();
-    if (head == tail) {
-        return 0;
+    const auto head = head_.load(std::memory_order_relaxed);
+    if (cached_tail_ - head < size)
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+
+    const auto count = std::min(size, cached_tail_ - head);
+    if (count == 0) {
+      return 0;
     }
-    const auto readable_size = (head <= tail) ? (tail - head) : (buffer_size_ - head);
-    const auto read_count = std::min(size, readable_size);
-    std::memcpy(ptr, buffer_.get() + head, read_count);
-    head_ = (head <= tail) ? tail : 0;
-    return read_count;
+
+    const auto offset = head & mask_;
+    const auto first = std::min(count, contiguous(offset));
+    std::memcpy(ptr, buffer_ + offset, first);
+    std::memcpy(ptr + first, buffer_, count - first);
+
+    head_.store(head + count, std::memory_order_release);
+    return count;
   }
 
+  /// writes up to `size` bytes from `ptr`, returns how many it did.
   auto write(const char* ptr, std::size_t size) -> std::size_t
   {
-    const auto head = head_.load();
-    const auto tail = tail_.load();
-    if (buffer_size_ == (head + tail - 1)) {
-        return 0;
+    const auto tail = tail_.load(std::memory_order_relaxed);
+    if (capacity() - (tail - cached_head_) < size)
+      cached_head_ = head_.load(std::memory_order_acquire);
+
+    const auto count = std::min(size, capacity() - (tail - cached_head_));
+    if (count == 0) {
+      return 0;
     }
-    const auto writable_size = (head <= tail) ? (buffer_size_ - tail) : (head - tail);
-    const auto write_count = std::min(size, writable_size);
-    std::memcpy(buffer_.get() + tail, ptr, write_count);
-    tail_ = (head <= tail) ? 0 : head - 1;
-    return write_count;
+
+    const auto offset = tail & mask_;
+    const auto first = std::min(count, contiguous(offset));
+    std::memcpy(buffer_ + offset, ptr, first);
+    std::memcpy(buffer_, ptr + first, count - first);
+
+    publish(tail + count);
+    return count;
+  }
+
+  /// up to `size` free bytes to write into in place, made readable by
+  /// `commit_write`. shorter when the ring is full or (unless mirrored)
+  /// wraps around first.
+  [[nodiscard]] auto prepare_write(std::size_t size) -> Span<char>
+  {
+    const auto tail = tail_.load(std::memory_order_relaxed);
+    if (capacity() - (tail - cached_head_) < size)
+      cached_head_ = head_.load(std::memory_order_acquire);
+
+    const auto offset = tail & mask_;
+    const auto count = std::min({size, capacity() - (tail - cached_head_),
+                                 contiguous(offset)});
+    return Span<char>(buffer_ + offset, count);
+  }
+
+  /// publishes the first `size` bytes of the last `prepare_write` span.
+  void commit_write(std::size_t size)
+  {
+    const auto tail = tail_.load(std::memory_order_relaxed);
+    publish(tail + size);
+  }
+
+  /// the readable bytes up to the end of the buffer (all of them if it's
+  /// mirrored), to be used in place and then freed by `consume`.
+  /// the rest of them (if it wraps around) comes next time.
+  [[nodiscard]] auto peek_read() -> Span<char>
+  {
+    const auto head = head_.load(std::memory_order_relaxed);
+    cached_tail_ = tail_.load(std::memory_order_acquire);
+
+    const auto offset = head & mask_;
+    const auto count = std::min(cached_tail_ - head, contiguous(offset));
+    return Span<char>(buffer_ + offset, count);
+  }
+
+  /// frees the first `size` bytes of the last `peek_read` span.
+  void consume(std::size_t size)
+  {
+    const auto head = head_.load(std::memory_order_relaxed);
+    head_.store(head + size, std::memory_order_release);
+  }
+
+  /// blocks until at least `size` bytes are readable;
+  /// a `size` over the capacity waits for a full buffer.
+  void wait_readable(std::size_t size = 1)
+  {
+    size = std::min(size, capacity());
+    for (std::size_t round = 0; !readable(size); ++round) {
+      if (backoff(round)) continue;
+      if (!start_parking(size)) return;
+      futex_wait(parked_, 1);
+    }
+  }
+
+  /// like wait_readable, but gives up after `timeout`.
+  /// returns whether `size` bytes (or a full buffer) are readable.
+  template <typename Rep, typename Period>
+  auto wait_readable_for(std::size_t size,
+                         const std::chrono::duration<Rep, Period>& timeout)
+      -> bool
+  {
+    size = std::min(size, capacity());
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (std::size_t round = 0; !readable(size); ++round) {
+      if (backoff(round)) continue;
+
+      const auto left = deadline - std::chrono::steady_clock::now();
+      if (left <= left.zero()) return false;
+
+      if (!start_parking(size)) return true;
+      futex_wait_for(
+          parked_, 1,
+          std::chrono::duration_cast<std::chrono::nanoseconds>(left));
+    }
+    return true;
+  }
+
+ private:
+  /// makes the written bytes readable, waking the consumer if it's parked.
+  /// the fence pairs with start_parking's: either the consumer sees the new
+  /// tail, or this sees it parked.
+  void publish(std::size_t tail) noexcept
+  {
+    tail_.store(tail, std::memory_order_release);
+    light_fence();
+    if (parked_.load(std::memory_order_relaxed) != 0) {
+      parked_.store(0, std::memory_order_relaxed);
+      futex_wake_one(parked_);
+    }
+  }
+
+  /// (consumer) whether `size` bytes are readable.
+  auto readable(std::size_t size) noexcept -> bool
+  {
+    const auto head = head_.load(std::memory_order_relaxed);
+    if (cached_tail_ - head < size)
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+    return cached_tail_ - head >= size;
+  }
+
+  /// announces the consumer is about to park, unless the data slipped in
+  /// meanwhile. returns whether it should still park.
+  auto start_parking(std::size_t size) noexcept -> bool
+  {
+    parked_.store(1, std::memory_order_relaxed);
+    heavy_fence();
+    const auto tail = tail_.load(std::memory_order_acquire);
+    if (tail - head_.load(std::memory_order_relaxed) >= size) {
+      parked_.store(0, std::memory_order_relaxed);
+      return false;
+    }
+    return true;
+  }
+
+  /// spins a little before parking, as data is often just a moment away.
+  static auto backoff(std::size_t round) noexcept -> bool
+  {
+    if (round < 64) {
+      cpu_relax();
+      return true;
+    }
+    if (round < 80) {
+      std::this_thread::yield();
+      return true;
+    }
+    return false;
+  }
+
+  /// how many bytes from `offset` on can be accessed in one go.
+  [[nodiscard]] auto contiguous(std::size_t offset) const noexcept
+      -> std::size_t
+  {
+    return mirrored_ ? capacity() : capacity() - offset;
   }
 };
 
@@ -1,105 +1,899 @@
 #ifndef TOYPP_THREADED_THREADPOOL_HPP_
 #define TOYPP_THREADED_THREADPOOL_HPP_
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <atomic>
-#include <vector>
-#include <queue>
+#include <exception>
 #include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 
+#include "../uniquefunction.hpp"
+#include "affinity.hpp"
+#include "future.hpp"
+#include "hardware.hpp"
+#include "histogram.hpp"
+#include "workstealing_deque.hpp"
+
 namespace tpp {
 
+namespace detail {
+
+/// a packaged call that is also the shared state of its own `Future`.
+template <typename R, typename F, typename ...Args>
+class FutureTask final : public FutureState<R> {
+  F fn_;
+  std::tuple<Args...> args_;
+
+ public:
+  template <typename U, typename ...Us>
+  explicit FutureTask(U&& fn, Us&&... args)
+    : fn_(std::forward<U>(fn))
+    , args_(std::forward<Us>(args)...)
+  {}
+
+  void run() noexcept {
+    try {
+      if constexpr (std::is_void<R>::value) {
+        std::apply(fn_, std::move(args_));
+        this->set_value();
+      } else {
+        this->set_value(std::apply(fn_, std::move(args_)));
+      }
+    } catch (...) {
+      this->set_exception(std::current_exception());
+    }
+  }
+
+  void abandon() noexcept {
+    this->set_broken();
+    this->release();
+  }
+};
+
+/// the pool's reference to a FutureTask; breaks the promise if dropped unrun.
+template <typename Task>
+class FutureTaskRef {
+  Task* task_;
+
+ public:
+  explicit FutureTaskRef(Task* task) noexcept : task_(task) {}
+
+  FutureTaskRef(FutureTaskRef&& other) noexcept
+    : task_(std::exchange(other.task_, nullptr))
+  {}
+
+  FutureTaskRef& operator=(FutureTaskRef&&) = delete;
+
+  ~FutureTaskRef() {
+    if (task_) task_->abandon();
+  }
+
+  void operator()() noexcept {
+    auto* task = std::exchange(task_, nullptr);
+    task->run();
+    task->release();
+  }
+};
+
+}  // namespace detail
+
+/**
+ * What a worker does when it runs out of tasks, before parking.
+ *
+ * It first spins up to `spins` rounds of `cpu_relax()`, then yields
+ * `yields` times, checking for new tasks in between. Once parked, waking
+ * it up costs a syscall on both sides and tens of microseconds.
+ * When `adaptive`, each worker halves its spin budget whenever it ends up
+ * parking anyway, and doubles it (up to `spins`) whenever a task showed up
+ * while spinning, so it spins only as long as tasks tend to arrive.
+ */
+struct IdlePolicy {
+  std::uint32_t spins = 1024;
+  std::uint32_t yields = 4;
+  bool adaptive = true;
+};
+
+/// construction options of a `ThreadPool`.
+struct ThreadPoolOptions {
+  std::size_t workers = 0;  // 0 for one per hardware thread.
+  Affinity affinity = Affinity::none;
+  std::vector<int> cpus;  // for Affinity::explicit_cpus.
+  std::string name = "tpp-worker";  // threads are named "<name>-<index>".
+  IdlePolicy idle;
+
+  /// track busy/idle times and queue latency, at two clock reads per task.
+  bool timing = false;
+
+  /// called around each task by the thread running it, with its worker
+  /// index (or `ThreadPool::no_worker`), e.g. to write trace events.
+  std::function<void(std::size_t worker)> on_task_begin;
+  std::function<void(std::size_t worker)> on_task_end;
+};
+
+/**
+ * @brief A work-stealing thread pool.
+ *
+ * Tasks added from outside of the pool go to a shared queue,
+ * while tasks added by a worker (i.e. from within a running task)
+ * go to that worker's own deque, where it takes them in LIFO order.
+ * Idle workers steal from the other workers' deques.
+ *
+ * Tasks are kept in recycled nodes as `UniqueFunction`s, so adding a task
+ * whose captures fit the inline buffer doesn't allocate.
+ *
+ * High and background priority tasks always go to their own shared lanes.
+ * Workers take high priority tasks before anything else, and background
+ * ones only when there's nothing else to do, or once every
+ * `background_turn` tasks so they won't starve.
+ *
+ * When workers are pinned to cpus, the shared queues are split per numa node.
+ * Tasks are queued on the node of the cpu they're added from, and workers
+ * look at their own node's queue (and steal from its workers) first.
+ */
 class ThreadPool {
-  using task_type = std::function<void()>;
+ public:
+  using task_type = UniqueFunction<void(), 48>;
+
+  enum class Priority { high, normal, background };
+
+  static constexpr std::size_t background_turn = 64;
+
+  /// worker index passed to task hooks for threads not of the pool.
+  static constexpr std::size_t no_worker = static_cast<std::size_t>(-1);
+
+  /// counters of a worker since it started; times are kept only with
+  /// `ThreadPoolOptions::timing`.
+  struct WorkerStats {
+    std::uint64_t tasks = 0;
+    std::uint64_t steals = 0;
+    std::uint64_t parks = 0;
+    std::uint64_t deque_high_water = 0;  // most tasks in its deque at once.
+    std::int64_t busy_ns = 0;
+    std::int64_t idle_ns = 0;
+  };
+
+ private:
+  struct TaskNode {
+    task_type fn;
+    TaskNode* next = nullptr;
+    std::int64_t enqueued_at = 0;  // only with timing_.
+  };
+
+  /// written only by the owning worker, so plain loads and stores suffice,
+  /// atomic only so others can read them at any time.
+  struct Counters {
+    std::atomic<std::uint64_t> tasks{0};
+    std::atomic<std::uint64_t> steals{0};
+    std::atomic<std::uint64_t> parks{0};
+    std::atomic<std::uint64_t> deque_high_water{0};
+    std::atomic<std::int64_t> busy_ns{0};
+    std::atomic<std::int64_t> idle_ns{0};
+    std::int64_t last_end = 0;  // owner only.
+  };
+
+  template <typename T>
+  static void add_to(std::atomic<T>& counter, T value) noexcept {
+    counter.store(counter.load(std::memory_order_relaxed) + value,
+                  std::memory_order_relaxed);
+  }
+
+  template <typename T>
+  static void raise_to(std::atomic<T>& counter, T value) noexcept {
+    auto current = counter.load(std::memory_order_relaxed);
+    while (current < value
+           && !counter.compare_exchange_weak(current, value,
+                                             std::memory_order_relaxed)) {}
+  }
+
+  /// intrusive FIFO of nodes, guarded by its NodeQueue's mutex.
+  struct TaskList {
+    TaskNode* head = nullptr;
+    TaskNode* tail = nullptr;
+    std::atomic<std::size_t> size{0};  // readable without the lock.
+
+    void push(TaskNode* node) noexcept {
+      if (tail)
+        tail->next = node;
+      else
+        head = node;
+      tail = node;
+      size.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    TaskNode* pop() noexcept {
+      TaskNode* node = head;
+      if (!node) return nullptr;
+
+      head = std::exchange(node->next, nullptr);
+      if (!head)
+        tail = nullptr;
+      size.fetch_sub(1, std::memory_order_relaxed);
+      return node;
+    }
+
+    /// moves all of `other`'s nodes to the back of this one.
+    void splice(TaskList& other) noexcept {
+      if (!other.head) return;
+
+      if (tail)
+        tail->next = other.head;
+      else
+        head = other.head;
+      tail = std::exchange(other.tail, nullptr);
+      other.head = nullptr;
+      size.fetch_add(other.size.exchange(0, std::memory_order_relaxed),
+                     std::memory_order_relaxed);
+    }
+  };
+
+  /// LIFO stack of spare nodes.
+  struct FreeList {
+    TaskNode* head = nullptr;
+    std::size_t count = 0;
+
+    void push(TaskNode* node) noexcept {
+      node->next = std::exchange(head, node);
+      ++count;
+    }
 
-  std::vector<std::thread> workers_;
-  std::mutex               mutex_; // restrict access to queue.
+    TaskNode* pop() noexcept {
+      TaskNode* node = head;
+      if (!node) return nullptr;
+
+      head = std::exchange(node->next, nullptr);
+      --count;
+      return node;
+    }
+  };
+
+  /// a numa node's part of the shared queues and of the node cache.
+  /// the cache is kept as whole worker caches, so handing one over or
+  /// taking one back is O(1) under the lock.
+  struct alignas(cache_line_size) NodeQueue {
+    std::mutex mutex;
+    TaskList lanes[3];  // one per Priority.
+    std::vector<FreeList> free_batches;  // none empty; reserved up front.
+    std::atomic<std::size_t> free_count{0};  // nodes in all batches.
+  };
+
+  struct alignas(cache_line_size) Worker {
+    WorkStealingDeque<TaskNode*> deque;
+    FreeList free_nodes;  // owner only.
+    std::size_t since_background = 0;  // tasks run since a background one.
+    std::size_t node = 0;  // index in nodes_.
+    int cpu = -1;  // pinned to, if not negative.
+    std::uint32_t spin_budget = 0;
+    Counters counters;
+    std::vector<std::size_t> victims;  // ones on the same node first.
+    std::thread thread;
+  };
+
+  static constexpr std::size_t max_cached_nodes = 1024;  // per worker.
+
+  inline static thread_local ThreadPool* current_pool_ = nullptr;
+  inline static thread_local std::size_t current_index_ = 0;
+
+  CpuTopology topology_;
+  std::string name_;
+  IdlePolicy idle_;
+  bool timing_;
+  std::function<void(std::size_t)> on_task_begin_;
+  std::function<void(std::size_t)> on_task_end_;
+  std::vector<std::unique_ptr<NodeQueue>> nodes_;
+  std::vector<std::unique_ptr<Worker>> workers_;  // kept until destruction.
+  std::atomic<std::size_t> running_workers_{0};
+  std::mutex               mutex_; // guards parking.
   std::condition_variable  cv_; // wait and notify on new task.
-  std::queue<task_type>    queue_;
+  std::atomic<std::size_t> sleepers_{0};
+  std::atomic<std::size_t> spinners_{0};
+  std::atomic<std::int64_t> notified_at_{0};  // steady_clock_ns().
+  LatencyHistogram         wakeup_latency_;
+  LatencyHistogram         queue_latency_;
+  std::atomic<std::size_t> queue_high_water_{0};
   std::atomic<bool>        halted_{false};
   std::atomic<bool>        shutdowned_{false};
 
-  void worker_loop() {
+  void worker_loop(std::size_t index) {
+    current_pool_ = this;
+    current_index_ = index;
+
+    auto& worker = *workers_[index];
+    if (worker.cpu >= 0)
+      pin_current_thread(worker.cpu);
+    if (!name_.empty())
+      name_current_thread(name_ + "-" + std::to_string(index));
+
     while (true) {
-      task_type task;
+      if (shutdowned_.load(std::memory_order_relaxed)) return;
+
+      if (run_next(index) || spin_for_tasks(worker))
+        continue;
+
+      std::unique_lock<std::mutex> lock{mutex_};
+      sleepers_.fetch_add(1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+
+      const bool idle = !has_tasks();
+      if (idle && halted_.load(std::memory_order_relaxed)) {
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+        return;  // nothing left to do.
+      }
+
+      if (idle) {
+        add_to<std::uint64_t>(worker.counters.parks, 1);
+        const auto parked_at = steady_clock_ns();
+        cv_.wait(lock);
+
+        const auto notified_at = notified_at_.load(std::memory_order_relaxed);
+        if (notified_at >= parked_at)
+          wakeup_latency_.record(steady_clock_ns() - notified_at);
+      }
+
+      sleepers_.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+  /// spins and then yields while waiting for a task, per the idle policy.
+  /// returns true if one showed up.
+  bool spin_for_tasks(Worker& worker) {
+    if (worker.spin_budget == 0 && idle_.yields == 0) return false;
+
+    spinners_.fetch_add(1, std::memory_order_relaxed);
+
+    bool found = false;
+    for (std::uint32_t i = 0; i < worker.spin_budget && !found; ++i) {
+      cpu_relax();
+      found = has_tasks();
+    }
+    const bool found_spinning = found;
+
+    for (std::uint32_t i = 0; i < idle_.yields && !found; ++i) {
+      if (halted_.load(std::memory_order_relaxed)) break;
+      std::this_thread::yield();
+      found = has_tasks();
+    }
+
+    spinners_.fetch_sub(1, std::memory_order_relaxed);
+
+    if (idle_.adaptive) {
+      if (found_spinning)
+        worker.spin_budget = std::min(idle_.spins, worker.spin_budget * 2);
+      else if (!found)
+        worker.spin_budget = std::max((idle_.spins + 63) / 64,
+                                      worker.spin_budget / 2);
+    }
+
+    return found;
+  }
+
+  bool run_next(std::size_t index) {
+    auto& worker = *workers_[index];
+    if (worker.since_background >= background_turn) {
+      worker.since_background = 0;
+      if (run_queued(Priority::background, worker.node)) return true;
+    }
+
+    if (run_queued(Priority::high, worker.node)
+        || run_local(index)
+        || run_queued(Priority::normal, worker.node)
+        || run_stolen(index)) {
+      ++worker.since_background;
+      return true;
+    }
 
+    worker.since_background = 0;
+    return run_queued(Priority::background, worker.node);
+  }
+
+  bool run_local(std::size_t index) {
+    const auto node = workers_[index]->deque.pop();
+    if (!node) return false;
+
+    run_node(*node);
+    return true;
+  }
+
+  /// runs a task of `priority` from the `home` node's queue, or another's.
+  bool run_queued(Priority priority, std::size_t home) {
+    const auto count = nodes_.size();
+    for (std::size_t i = 0; i < count; ++i) {
+      auto& queue = *nodes_[(home + i) % count];
+      auto& lane = queue.lanes[static_cast<std::size_t>(priority)];
+      if (lane.size.load(std::memory_order_relaxed) == 0) continue;
+
+      TaskNode* node = nullptr;
       {
-        std::unique_lock<std::mutex> lock{mutex_};
-        cv_.wait(lock, [this] { return !queue_.empty(); });
+        std::lock_guard<std::mutex> lock{queue.mutex};
+        node = lane.pop();
+      }
+      if (node) {
+        run_node(node);
+        return true;
+      }
+    }
+    return false;
+  }
 
-        if (shutdowned_.load(std::memory_order_relaxed)) return;
-        if (!queue_.front()) return; // poison pill.
+  bool run_stolen(std::size_t index) {
+    for (const auto victim : workers_[index]->victims) {
+      if (const auto node = workers_[victim]->deque.steal()) {
+        add_to<std::uint64_t>(workers_[index]->counters.steals, 1);
+        run_node(*node);
+        return true;
+      }
+    }
+    return false;
+  }
 
-        task = std::move(queue_.front());
-        queue_.pop();
+  bool has_queued_tasks() const noexcept {
+    for (const auto& queue : nodes_)
+      for (const auto& lane : queue->lanes)
+        if (lane.size.load(std::memory_order_relaxed)) return true;
+    return false;
+  }
+
+  /// node whose queue tasks added by the calling thread go to.
+  std::size_t home_node() const noexcept {
+    if (current_pool_ == this) return workers_[current_index_]->node;
+    if (nodes_.size() == 1) return 0;
+    return topology_.node_of(current_cpu());
+  }
+
+  bool has_local_tasks() const noexcept {
+    for (const auto& worker : workers_)
+      if (!worker->deque.empty()) return true;
+    return false;
+  }
+
+  bool has_tasks() const noexcept {
+    return has_queued_tasks() || has_local_tasks();
+  }
+
+  /// runs and recycles the node; if its task throws, the bookkeeping is
+  /// still done before the exception reaches the caller (a worker thread
+  /// terminates, while run_pending_task passes it on).
+  void run_node(TaskNode* node) {
+    const bool on_worker = current_pool_ == this;
+    const auto index = on_worker ? current_index_ : no_worker;
+    Counters* counters = on_worker ? &workers_[index]->counters : nullptr;
+
+    std::int64_t started_at = 0;
+    if (timing_) {
+      started_at = steady_clock_ns();
+      queue_latency_.record(started_at - node->enqueued_at);
+      if (counters && counters->last_end)
+        add_to(counters->idle_ns, started_at - counters->last_end);
+    }
+
+    std::exception_ptr error;
+    try {
+      if (on_task_begin_) on_task_begin_(index);
+      node->fn();
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    if (counters) {
+      add_to<std::uint64_t>(counters->tasks, 1);
+      if (timing_) {
+        counters->last_end = steady_clock_ns();
+        add_to(counters->busy_ns, counters->last_end - started_at);
+      }
+    }
+    if (on_task_end_) on_task_end_(index);
+
+    node->fn = nullptr;
+    recycle_node(node);
+
+    if (error)
+      std::rethrow_exception(error);
+  }
+
+  /// keeps the node in the calling worker's cache,
+  /// handing the whole cache to its node's one when it's full.
+  void recycle_node(TaskNode* node) {
+    if (current_pool_ != this) {
+      delete node;
+      return;
+    }
+
+    auto& worker = *workers_[current_index_];
+    if (worker.free_nodes.count >= max_cached_nodes) {
+      auto& queue = *nodes_[worker.node];
+      std::lock_guard<std::mutex> lock{queue.mutex};
+      if (queue.free_batches.size() < workers_.size()) {
+        queue.free_count.fetch_add(worker.free_nodes.count,
+                                   std::memory_order_relaxed);
+        queue.free_batches.push_back(std::exchange(worker.free_nodes, {}));
+      }
+    }
+
+    if (worker.free_nodes.count >= max_cached_nodes) {
+      delete node;
+      return;
+    }
+
+    worker.free_nodes.push(node);
+  }
+
+  /// takes a node from the calling worker's cache,
+  /// refilling it with one batch of its node's cache when it's empty.
+  TaskNode* acquire_node(Worker& worker) {
+    auto& queue = *nodes_[worker.node];
+    if (!worker.free_nodes.head
+        && queue.free_count.load(std::memory_order_relaxed)) {
+      std::lock_guard<std::mutex> lock{queue.mutex};
+      if (!queue.free_batches.empty()) {
+        worker.free_nodes = queue.free_batches.back();
+        queue.free_batches.pop_back();
+        queue.free_count.fetch_sub(worker.free_nodes.count,
+                                   std::memory_order_relaxed);
+      }
+    }
+
+    if (TaskNode* node = worker.free_nodes.pop()) return node;
+    return new TaskNode;
+  }
+
+  static void delete_nodes(TaskNode* head) noexcept {
+    while (head)
+      delete std::exchange(head, head->next);
+  }
+
+  static TaskNode* take_shared_node_unsafe(NodeQueue& queue) noexcept {
+    if (queue.free_batches.empty()) return nullptr;
+
+    auto& batch = queue.free_batches.back();
+    TaskNode* node = batch.pop();
+    if (!batch.head) queue.free_batches.pop_back();
+    queue.free_count.fetch_sub(1, std::memory_order_relaxed);
+    return node;
+  }
+
+  void push_task(task_type&& task, Priority priority) {
+    if (current_pool_ == this && priority == Priority::normal) {
+      auto& worker = *workers_[current_index_];
+      TaskNode* node = acquire_node(worker);
+      node->fn = std::move(task);
+      if (timing_) node->enqueued_at = steady_clock_ns();
+      worker.deque.push(node);
+      raise_to<std::uint64_t>(worker.counters.deque_high_water,
+                              worker.deque.size());
+      notify_sleepers(1);
+      return;
+    }
+
+    auto& queue = *nodes_[home_node()];
+    {
+      std::unique_lock<std::mutex> lock{queue.mutex};
+      TaskNode* node = take_shared_node_unsafe(queue);
+      if (!node) {
+        lock.unlock();
+        node = new TaskNode;
+        lock.lock();
       }
 
-      task();
+      node->fn = std::move(task);
+      if (timing_) node->enqueued_at = steady_clock_ns();
+      queue.lanes[static_cast<std::size_t>(priority)].push(node);
+      raise_to(queue_high_water_, queued_count(queue));
     }
+    notify_sleepers(1);
+  }
+
+  static std::size_t queued_count(const NodeQueue& queue) noexcept {
+    std::size_t count = 0;
+    for (const auto& lane : queue.lanes)
+      count += lane.size.load(std::memory_order_relaxed);
+    return count;
+  }
+
+  void drop_queued() noexcept {
+    for (auto& queue : nodes_) {
+      std::lock_guard<std::mutex> lock{queue->mutex};
+      for (auto& lane : queue->lanes)
+        while (auto* node = lane.pop())
+          delete node;
+    }
+  }
+
+  static ThreadPoolOptions options_of(std::size_t workers) {
+    ThreadPoolOptions options;
+    options.workers = workers;
+    return options;
+  }
+
+  /// wakes up to `count` parked workers after pushing a task.
+  /// pairs with the fence in worker_loop, so either the worker sees the task
+  /// before parking, or we see it parked.
+  void notify_sleepers(std::size_t count) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_relaxed) == 0) return;
+
+    std::size_t sleepers = 0;
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      sleepers = sleepers_.load(std::memory_order_relaxed);
+    }
+    wake_sleepers(count, sleepers);
+  }
+
+  /// each notify_one is a syscall when someone waits, so never notify more
+  /// than are parked, and wake them all at once if all are needed.
+  void wake_sleepers(std::size_t count, std::size_t sleepers) {
+    if (count == 0 || sleepers == 0) return;
+
+    notified_at_.store(steady_clock_ns(), std::memory_order_relaxed);
+
+    if (count >= sleepers) {
+      cv_.notify_all();
+      return;
+    }
+
+    while (count--)
+      cv_.notify_one();
   }
 
  public:
-  ThreadPool() : ThreadPool(std::thread::hardware_concurrency()) {}
+  ThreadPool() : ThreadPool(ThreadPoolOptions{}) {}
+
+  ThreadPool(std::size_t size) : ThreadPool(options_of(size)) {}
 
-  ThreadPool(std::size_t size) {
+  explicit ThreadPool(const ThreadPoolOptions& options)
+    : topology_(options.affinity == Affinity::none
+                  ? CpuTopology(std::vector<std::vector<int>>{})
+                  : CpuTopology())
+    , name_(options.name)
+    , idle_(options.idle)
+    , timing_(options.timing)
+    , on_task_begin_(options.on_task_begin)
+    , on_task_end_(options.on_task_end)
+  {
+    auto size = options.workers;
     if (size == 0)
       size = std::thread::hardware_concurrency();
 
+    const auto cpus = topology_.assign(options.affinity, size, options.cpus);
+
+    nodes_.resize(options.affinity == Affinity::none
+                    ? 1 : topology_.nodes_count());
+    for (auto& queue : nodes_) {
+      queue = std::make_unique<NodeQueue>();
+      queue->free_batches.reserve(size);  // so recycling won't allocate.
+    }
+
     workers_.reserve(size);
+    for (std::size_t i = 0; i < size; ++i) {
+      auto worker = std::make_unique<Worker>();
+      worker->cpu = cpus[i];
+      worker->spin_budget = idle_.spins;
+      if (cpus[i] >= 0)
+        worker->node = topology_.node_of(cpus[i]);
+      workers_.push_back(std::move(worker));
+    }
+
+    // steal from the workers on the same node first.
+    for (std::size_t i = 0; i < size; ++i) {
+      auto& victims = workers_[i]->victims;
+      for (int same_node = 1; same_node >= 0; --same_node)
+        for (std::size_t j = 1; j < size; ++j) {
+          const auto victim = (i + j) % size;
+          if ((workers_[victim]->node == workers_[i]->node) == same_node)
+            victims.push_back(victim);
+        }
+    }
 
+    // workers start after all deques exist, as they steal from each other.
     for (std::size_t i = 0; i < size; ++i)
-      workers_.emplace_back(&ThreadPool::worker_loop, this);
+      workers_[i]->thread = std::thread(&ThreadPool::worker_loop, this, i);
+    running_workers_.store(size, std::memory_order_relaxed);
   }
 
   ThreadPool(const ThreadPool&) = delete;
 
   ~ThreadPool() {
-    if (shutdowned_.load(std::memory_order_relaxed))
-      return;
-
     if (!halted_.load(std::memory_order_relaxed))
       shutdown();
+
+    drop_queued();  // tasks added after shutdown.
+    for (auto& queue : nodes_)
+      for (auto& batch : queue->free_batches)
+        delete_nodes(batch.head);
   }
 
   bool running() const noexcept {
     return !halted_.load(std::memory_order_relaxed);
   }
 
-  std::size_t workers_count() const noexcept { return workers_.size(); }
+  /// count of worker threads; zero once shut down.
+  std::size_t workers_count() const noexcept {
+    return running_workers_.load(std::memory_order_relaxed);
+  }
 
-  std::size_t jobs_count() noexcept {
-    std::lock_guard<std::mutex> lock{mutex_};
-    return queue_.size();
+  /// count of workers spinning or parked for lack of tasks.
+  std::size_t idle_workers() const noexcept {
+    return sleepers_.load(std::memory_order_relaxed)
+           + spinners_.load(std::memory_order_relaxed);
+  }
+
+  /// time from notifying a parked worker until it's running again.
+  const LatencyHistogram& wakeup_latency() const noexcept {
+    return wakeup_latency_;
+  }
+
+  /// time from adding a task until it starts; only with timing.
+  const LatencyHistogram& queue_latency() const noexcept {
+    return queue_latency_;
+  }
+
+  /// most tasks waiting in a shared queue at once.
+  std::size_t queue_high_water() const noexcept {
+    return queue_high_water_.load(std::memory_order_relaxed);
+  }
+
+  /// the `index`th worker's counters; can be read while it runs,
+  /// and also after shutdown, for any `index` below the initial worker count.
+  WorkerStats worker_stats(std::size_t index) const noexcept {
+    const auto& counters = workers_[index]->counters;
+    WorkerStats stats;
+    stats.tasks = counters.tasks.load(std::memory_order_relaxed);
+    stats.steals = counters.steals.load(std::memory_order_relaxed);
+    stats.parks = counters.parks.load(std::memory_order_relaxed);
+    stats.deque_high_water =
+        counters.deque_high_water.load(std::memory_order_relaxed);
+    stats.busy_ns = counters.busy_ns.load(std::memory_order_relaxed);
+    stats.idle_ns = counters.idle_ns.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+  /// runs one pending task on the calling thread, if there is any.
+  /// lets a thread waiting on other tasks help out instead of blocking.
+  /// an exception thrown by the task is passed on to the caller.
+  bool run_pending_task() {
+    if (current_pool_ == this)
+      return run_next(current_index_);
+
+    const auto home = home_node();
+    if (run_queued(Priority::high, home) || run_queued(Priority::normal, home))
+      return true;
+
+    for (auto& worker : workers_) {
+      if (const auto node = worker->deque.steal()) {
+        run_node(*node);
+        return true;
+      }
+    }
+    return run_queued(Priority::background, home);
+  }
+
+  std::size_t jobs_count() const noexcept {
+    std::size_t count = 0;
+    for (const auto& queue : nodes_)
+      count += queued_count(*queue);
+    for (const auto& worker : workers_)
+      count += worker->deque.size();
+    return count;
   }
 
   template <typename F>
-  void add_task(F&& task) {
-    {
-      std::lock_guard<std::mutex> lock{mutex_};
-      queue_.emplace(std::forward<F>(task));
+  void add_task(F&& task, Priority priority = Priority::normal) {
+    push_task(task_type(std::forward<F>(task)), priority);
+  }
+
+  /// adds all tasks in [first, last), taking the queue lock only once and
+  /// waking at most as many parked workers as there are tasks.
+  /// if making a task throws, the ones before it are still added.
+  template <typename InputIt>
+  void add_tasks(InputIt first, InputIt last,
+                 Priority priority = Priority::normal) {
+    std::size_t count = 0;
+
+    if (current_pool_ == this && priority == Priority::normal) {
+      auto& worker = *workers_[current_index_];
+      const auto enqueued_at = timing_ ? steady_clock_ns() : 0;
+      try {
+        for (; first != last; ++first, ++count) {
+          task_type task(*first);
+          TaskNode* node = acquire_node(worker);
+          node->fn = std::move(task);
+          node->enqueued_at = enqueued_at;
+          worker.deque.push(node);
+        }
+      } catch (...) {
+        notify_sleepers(count);  // for the ones already pushed.
+        throw;
+      }
+      raise_to<std::uint64_t>(worker.counters.deque_high_water,
+                              worker.deque.size());
+      notify_sleepers(count);
+      return;
+    }
+
+    // nodes and tasks are made before taking the lock, which only splices.
+    const auto enqueued_at = timing_ ? steady_clock_ns() : 0;
+    TaskList batch;
+    std::exception_ptr error;
+    try {
+      for (; first != last; ++first) {
+        auto node = std::make_unique<TaskNode>();
+        node->fn = task_type(*first);
+        node->enqueued_at = enqueued_at;
+        batch.push(node.release());
+      }
+    } catch (...) {
+      error = std::current_exception();  // still queue the ones made so far.
     }
-    cv_.notify_one();
+
+    count = batch.size.load(std::memory_order_relaxed);
+    if (count) {
+      auto& queue = *nodes_[home_node()];
+      std::lock_guard<std::mutex> lock{queue.mutex};
+      queue.lanes[static_cast<std::size_t>(priority)].splice(batch);
+      raise_to(queue_high_water_, queued_count(queue));
+    }
+    notify_sleepers(count);
+
+    if (error)
+      std::rethrow_exception(error);
+  }
+
+  /// like add_task, but returns a future of `fn(args...)`'s result.
+  /// the future's shared state and the packaged call are a single allocation.
+  template <typename F, typename ...Args,
+            std::enable_if_t<
+              !std::is_same<std::decay_t<F>, Priority>::value, bool> = true>
+  auto submit(F&& fn, Args&&... args) {
+    return submit(Priority::normal,
+                  std::forward<F>(fn), std::forward<Args>(args)...);
+  }
+
+  template <typename F, typename ...Args>
+  auto submit(Priority priority, F&& fn, Args&&... args) {
+    using result_type =
+        std::invoke_result_t<std::decay_t<F>&, std::decay_t<Args>...>;
+    using state_type = detail::FutureTask<result_type,
+                                          std::decay_t<F>,
+                                          std::decay_t<Args>...>;
+
+    auto* state = new state_type(std::forward<F>(fn),
+                                 std::forward<Args>(args)...);
+    Future<result_type> future{state};
+    push_task(detail::FutureTaskRef<state_type>(state), priority);
+    return future;
   }
 
   /// graceful shutdown; lets workers do all the tasks in queue so far.
   void shutdown() {
     halted_.store(true, std::memory_order_relaxed);
 
-    {
-      std::lock_guard<std::mutex> lock{mutex_};
-      queue_.emplace(task_type{}); // aka poison pill.
-    }
+    { std::lock_guard<std::mutex> lock{mutex_}; }
     cv_.notify_all();
 
     for (auto& worker : workers_)
-      worker.join();
+      if (worker->thread.joinable())
+        worker->thread.join();
 
     shutdowned_.store(true, std::memory_order_relaxed);
-    workers_.clear();
+    running_workers_.store(0, std::memory_order_relaxed);
+
+    // the workers themselves stay, so their stats are still readable.
+    for (auto& worker : workers_) {
+      // only left behind by force_shutdown.
+      while (const auto node = worker->deque.pop())
+        delete *node;
+      delete_nodes(std::exchange(worker->free_nodes, {}).head);
+    }
+    drop_queued();
   }
 
   /// forces workers to leave queued tasks and stop when current task is done.
@@ -0,0 +1,68 @@
+#ifndef TOYPP_THREADED_TICKETMUTEX_HPP_
+#define TOYPP_THREADED_TICKETMUTEX_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "hardware.hpp"
+
+namespace tpp {
+
+/**
+ * @brief A fair (FIFO) spin lock, handing out tickets like a bakery.
+ *
+ * `lock` takes the next ticket and waits until it's served, so threads get
+ * the lock in the order they asked for it. Waiters pause in proportion to
+ * how many are ahead of them, and yield after a while, as they'd otherwise
+ * keep the cpu from a preempted thread ahead in the line.
+ *
+ * All waiters still read the same cache line, see McsMutex for one that
+ * has each of them spin on its own. Same interface as SpinMutex.
+ */
+class TicketMutex {
+  static constexpr std::uint32_t pauses_per_waiter = 16;
+  static constexpr std::uint32_t yield_after = 64;  // rounds.
+
+  alignas(cache_line_size) std::atomic<std::uint32_t> next_{0};
+  alignas(cache_line_size) std::atomic<std::uint32_t> serving_{0};
+
+ public:
+  TicketMutex() {}
+  TicketMutex(const TicketMutex&) = delete;
+  TicketMutex& operator=(const TicketMutex&) = delete;
+
+  void lock() noexcept {
+    const auto ticket = next_.fetch_add(1, std::memory_order_relaxed);
+    for (std::uint32_t round = 0; true; ++round) {
+      const auto serving = serving_.load(std::memory_order_acquire);
+      if (serving == ticket) return;
+
+      if (round < yield_after) {
+        const auto pauses = (ticket - serving) * pauses_per_waiter;
+        for (std::uint32_t i = 0; i < pauses; ++i) cpu_relax();
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  bool try_lock() noexcept {
+    auto serving = serving_.load(std::memory_order_acquire);
+    return next_.compare_exchange_strong(serving, serving + 1,
+                                         std::memory_order_acquire,
+                                         std::memory_order_relaxed);
+  }
+
+  void unlock() noexcept {
+    serving_.store(serving_.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_release);
+  }
+
+  void acquire() noexcept { lock(); }
+  void release() noexcept { unlock(); }
+};
+
+}  // namespace tpp
+
+#endif  // TOYPP_THREADED_TICKETMUTEX_HPP_
@@ -0,0 +1,93 @@
+#ifndef TOYPP_THREADED_TRIPLEBUFFER_HPP_
+#define TOYPP_THREADED_TRIPLEBUFFER_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "hardware.hpp"
+
+namespace tpp {
+
+/**
+ * @brief A wait-free TripleBuffer to hand the latest value
+ *        from one writer thread to one reader thread.
+ *
+ * Like DoubleBuffer, but with a third buffer in the middle, so neither side
+ * ever waits for the other: `writer_arrive` publishes the writer buffer by
+ * swapping it with the middle one in a single atomic exchange, and
+ * `reader_arrive` swaps the reader buffer with the middle one if a newer
+ * value has been published since, so the reader always gets the latest
+ * complete value, skipping any it was too slow for.
+ *
+ * The buffer the writer gets back is an older one, not a copy of what it
+ * just published, so it has to be written anew.
+ *
+ * @tparam BufferT buffer type.
+ */
+template <typename BufferT>
+class TripleBuffer {
+ public:
+  using buffer_type = std::remove_reference_t<BufferT>;
+
+ private:
+  struct alignas(cache_line_size) Slot {
+    buffer_type buffer = {};
+  };
+
+  static constexpr std::uint8_t index_mask = 0b011;
+  static constexpr std::uint8_t fresh_bit = 0b100;  // unread in the middle.
+
+  Slot slots_[3] = {};
+
+  alignas(cache_line_size) std::atomic<std::uint8_t> middle_index_{1};
+  alignas(cache_line_size) std::uint8_t writer_index_ = 0;
+  alignas(cache_line_size) std::uint8_t reader_index_ = 2;
+
+ public:
+  TripleBuffer() {}
+
+  TripleBuffer(buffer_type a, buffer_type b, buffer_type c)
+    : slots_{ {std::move(a)}, {std::move(b)}, {std::move(c)} }
+  {}
+
+  /// publishes the writer buffer, and takes another one to write into.
+  void writer_arrive() noexcept {
+    writer_index_ = middle_index_.exchange(writer_index_ | fresh_bit,
+                                           std::memory_order_acq_rel)
+                    & index_mask;
+  }
+
+  /// switches to the latest published buffer, if there's a newer one
+  /// than the reader buffer, and returns whether there was.
+  bool reader_arrive() noexcept {
+    if ((middle_index_.load(std::memory_order_relaxed) & fresh_bit) == 0)
+      return false;
+
+    reader_index_ = middle_index_.exchange(reader_index_,
+                                           std::memory_order_acq_rel)
+                    & index_mask;
+    return true;
+  }
+
+  buffer_type& reader_buffer() noexcept {
+    return slots_[reader_index_].buffer;
+  }
+
+  const buffer_type& reader_buffer() const noexcept {
+    return slots_[reader_index_].buffer;
+  }
+
+  buffer_type& writer_buffer() noexcept {
+    return slots_[writer_index_].buffer;
+  }
+
+  const buffer_type& writer_buffer() const noexcept {
+    return slots_[writer_index_].buffer;
+  }
+};
+
+}  // namespace tpp
+
+#endif  // TOYPP_THREADED_TRIPLEBUFFER_HPP_
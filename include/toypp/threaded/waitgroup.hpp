@@ -0,0 +1,79 @@
+#ifndef TOYPP_THREADED_WAITGROUP_HPP_
+#define TOYPP_THREADED_WAITGROUP_HPP_
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+
+#include "futex.hpp"
+
+namespace tpp {
+
+/**
+ * @brief Waits for a group of tasks to finish, as Go's `sync.WaitGroup`.
+ *
+ * `add` counts the tasks before they're started, each calls `done` when
+ * it's finished, and `wait` returns once the count is back to zero. Unlike
+ * a Latch it can be reused, as long as no `add` from zero races a `wait`.
+ *
+ * The count is a futex word, and `done` is its last touch, so a task can
+ * call it on a group that's gone as soon as the waiter wakes up:
+ *
+ *     tpp::WaitGroup group;
+ *     for (auto& part : parts) {
+ *       group.add();
+ *       pool.add_task([&] { work(part); group.done(); });
+ *     }
+ *     group.wait(pool);  // helps with the tasks, instead of just waiting.
+ */
+class WaitGroup {
+  std::atomic<std::uint32_t> count_{0};
+
+ public:
+  WaitGroup() {}
+  WaitGroup(const WaitGroup&) = delete;
+  WaitGroup& operator=(const WaitGroup&) = delete;
+
+  /// tasks not done yet.
+  std::uint32_t count() const noexcept {
+    return count_.load(std::memory_order_relaxed) & ~detail::sleepers_bit;
+  }
+
+  void add(std::uint32_t n = 1) noexcept {
+    count_.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  /// each call needs an `add` before it; more would wrap the count around.
+  void done() noexcept {
+    // the last one also clears the sleepers bit, for the group's next round.
+    auto count = count_.load(std::memory_order_relaxed);
+    std::uint32_t next;
+    do {
+      assert((count & ~detail::sleepers_bit) != 0 && "done() without add()");
+      next = (count & ~detail::sleepers_bit) == 1 ? 0 : count - 1;
+    } while (!count_.compare_exchange_weak(count, next,
+                                           std::memory_order_acq_rel,
+                                           std::memory_order_relaxed));
+    if (next == 0) detail::wake_sleepers(count_, count);
+  }
+
+  bool try_wait() const noexcept {
+    return (count_.load(std::memory_order_acquire) & ~detail::sleepers_bit)
+           == 0;
+  }
+
+  void wait() noexcept {
+    detail::wait_until(count_, [](std::uint32_t count) { return count == 0; });
+  }
+
+  /// waits, running `pool`'s (e.g. a ThreadPool) pending tasks meanwhile.
+  template <typename Pool>
+  void wait(Pool& pool) {
+    detail::wait_until_helping(pool, count_,
+                               [](std::uint32_t count) { return count == 0; });
+  }
+};
+
+}  // namespace tpp
+
+#endif  // TOYPP_THREADED_WAITGROUP_HPP_
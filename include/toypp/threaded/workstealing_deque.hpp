@@ -0,0 +1,153 @@
+#ifndef TOYPP_THREADED_WORKSTEALING_DEQUE_HPP_
+#define TOYPP_THREADED_WORKSTEALING_DEQUE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#include "hardware.hpp"
+
+namespace tpp {
+
+/**
+ * @brief Chase-Lev work-stealing deque.
+ *
+ * The owner thread pushes and pops at the bottom (LIFO), while any other
+ * thread can steal from the top (FIFO) without taking a lock.
+ * The storage grows on demand, replaced arrays are kept until destruction
+ * as a thief might still be reading from them.
+ *
+ * `push` and `pop` must only be called by the owner thread.
+ *
+ * @tparam T trivially copyable element type, usually a pointer.
+ */
+template <typename T>
+class WorkStealingDeque {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "WorkStealingDeque elements must be trivially copyable.");
+
+ public:
+  using value_type = T;
+
+ private:
+  class Array {
+    std::int64_t capacity_;
+    std::unique_ptr<std::atomic<T>[]> items_;
+
+   public:
+    explicit Array(std::int64_t capacity)
+      : capacity_(capacity)
+      , items_(std::make_unique<std::atomic<T>[]>(capacity))
+    {}
+
+    std::int64_t capacity() const noexcept { return capacity_; }
+
+    T load(std::int64_t index) const noexcept {
+      return items_[index & (capacity_ - 1)].load(std::memory_order_relaxed);
+    }
+
+    void store(std::int64_t index, T value) noexcept {
+      items_[index & (capacity_ - 1)].store(value, std::memory_order_relaxed);
+    }
+  };
+
+  alignas(cache_line_size) std::atomic<std::int64_t> top_{0};
+  alignas(cache_line_size) std::atomic<std::int64_t> bottom_{0};
+  std::atomic<Array*> array_{nullptr};
+
+  std::vector<std::unique_ptr<Array>> arrays_;  // owner only.
+
+ public:
+  explicit WorkStealingDeque(std::size_t capacity = 256) {
+    std::int64_t cap = 1;
+    while (static_cast<std::size_t>(cap) < capacity) cap <<= 1;
+
+    arrays_.push_back(std::make_unique<Array>(cap));
+    array_.store(arrays_.back().get(), std::memory_order_relaxed);
+  }
+
+  WorkStealingDeque(const WorkStealingDeque&) = delete;
+  WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+  /// approximate count of elements, exact when called by the owner alone.
+  std::size_t size() const noexcept {
+    const auto b = bottom_.load(std::memory_order_relaxed);
+    const auto t = top_.load(std::memory_order_relaxed);
+    return b > t ? static_cast<std::size_t>(b - t) : 0;
+  }
+
+  bool empty() const noexcept { return size() == 0; }
+
+  void push(T value) {
+    const auto b = bottom_.load(std::memory_order_relaxed);
+    const auto t = top_.load(std::memory_order_acquire);
+    auto* array = array_.load(std::memory_order_relaxed);
+
+    if (b - t > array->capacity() - 1)
+      array = grow(array, b, t);
+
+    array->store(b, value);
+    bottom_.store(b + 1, std::memory_order_release);
+  }
+
+  std::optional<T> pop() noexcept {
+    const auto b = bottom_.load(std::memory_order_relaxed) - 1;
+    auto* array = array_.load(std::memory_order_relaxed);
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto t = top_.load(std::memory_order_relaxed);
+
+    if (t > b) {  // empty
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return std::nullopt;
+    }
+
+    std::optional<T> ret = array->load(b);
+    if (t == b) {  // last one, race against thieves.
+      if (!top_.compare_exchange_strong(t, t + 1,
+                                        std::memory_order_seq_cst,
+                                        std::memory_order_relaxed))
+        ret = std::nullopt;
+      bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+
+    return ret;
+  }
+
+  /// may spuriously return nothing when it loses a race to another thread.
+  std::optional<T> steal() noexcept {
+    auto t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const auto b = bottom_.load(std::memory_order_acquire);
+
+    if (t >= b) return std::nullopt;
+
+    auto* array = array_.load(std::memory_order_acquire);
+    T value = array->load(t);
+    if (!top_.compare_exchange_strong(t, t + 1,
+                                      std::memory_order_seq_cst,
+                                      std::memory_order_relaxed))
+      return std::nullopt;
+
+    return value;
+  }
+
+ private:
+  Array* grow(Array* array, std::int64_t b, std::int64_t t) {
+    arrays_.push_back(std::make_unique<Array>(array->capacity() * 2));
+    auto* bigger = arrays_.back().get();
+    for (auto i = t; i < b; ++i)
+      bigger->store(i, array->load(i));
+
+    array_.store(bigger, std::memory_order_release);
+    return bigger;
+  }
+};
+
+}  // namespace tpp
+
+#endif  // TOYPP_THREADED_WORKSTEALING_DEQUE_HPP_
@@ -0,0 +1,156 @@
+#ifndef TOYPP_UNIQUEFUNCTION_HPP_
+#define TOYPP_UNIQUEFUNCTION_HPP_
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace tpp {
+
+template <typename Signature, std::size_t Capacity = 4 * sizeof(void*)>
+class UniqueFunction;
+
+/**
+ * @brief A move-only `std::function` with a configurable inline buffer.
+ *
+ * Callables up to `Capacity` bytes (and nothrow movable) are stored inline,
+ * so wrapping them doesn't allocate; bigger ones are moved to the heap.
+ * Being move-only, it can hold lambdas capturing move-only objects
+ * such as `tpp::UniquePtr`.
+ *
+ * @tparam R(Args...) call signature.
+ * @tparam Capacity size of the inline buffer in bytes.
+ */
+template <typename R, typename ...Args, std::size_t Capacity>
+class UniqueFunction<R(Args...), Capacity> {
+ public:
+  using result_type = R;
+
+  static constexpr std::size_t inline_capacity = Capacity;
+
+ private:
+  struct VTable {
+    R (*invoke)(void* storage, Args&&... args);
+    void (*relocate)(void* from, void* to) noexcept;  // move and destroy.
+    void (*destroy)(void* storage) noexcept;
+  };
+
+  template <typename F>
+  static R call(F& fn, Args&&... args) {
+    if constexpr (std::is_void<R>::value)
+      std::invoke(fn, std::forward<Args>(args)...);
+    else
+      return std::invoke(fn, std::forward<Args>(args)...);
+  }
+
+  template <typename F>
+  struct InlineOps {
+    static F& get(void* storage) noexcept {
+      return *std::launder(static_cast<F*>(storage));
+    }
+
+    static R invoke(void* storage, Args&&... args) {
+      return call(get(storage), std::forward<Args>(args)...);
+    }
+
+    static void relocate(void* from, void* to) noexcept {
+      ::new (to) F(std::move(get(from)));
+      get(from).~F();
+    }
+
+    static void destroy(void* storage) noexcept { get(storage).~F(); }
+
+    static constexpr VTable vtable = {&invoke, &relocate, &destroy};
+  };
+
+  template <typename F>
+  struct HeapOps {
+    static F*& get(void* storage) noexcept {
+      return *std::launder(static_cast<F**>(storage));
+    }
+
+    static R invoke(void* storage, Args&&... args) {
+      return call(*get(storage), std::forward<Args>(args)...);
+    }
+
+    static void relocate(void* from, void* to) noexcept {
+      ::new (to) F*(get(from));
+    }
+
+    static void destroy(void* storage) noexcept { delete get(storage); }
+
+    static constexpr VTable vtable = {&invoke, &relocate, &destroy};
+  };
+
+  template <typename F>
+  static constexpr bool is_inline =
+      sizeof(F) <= Capacity
+      && alignof(F) <= alignof(std::max_align_t)
+      && std::is_nothrow_move_constructible<F>::value;
+
+  alignas(std::max_align_t)
+  unsigned char storage_[Capacity < sizeof(void*) ? sizeof(void*) : Capacity];
+  const VTable* vtable_ = nullptr;
+
+ public:
+  UniqueFunction() noexcept {}
+  UniqueFunction(std::nullptr_t) noexcept {}
+
+  template <typename F,
+            typename Fn = std::decay_t<F>,
+            std::enable_if_t<
+              !std::is_same<Fn, UniqueFunction>::value
+              && std::is_invocable_r<R, Fn&, Args...>::value,
+              bool> = true>
+  UniqueFunction(F&& fn) {
+    if constexpr (is_inline<Fn>) {
+      ::new (static_cast<void*>(storage_)) Fn(std::forward<F>(fn));
+      vtable_ = &InlineOps<Fn>::vtable;
+    } else {
+      ::new (static_cast<void*>(storage_)) Fn*(new Fn(std::forward<F>(fn)));
+      vtable_ = &HeapOps<Fn>::vtable;
+    }
+  }
+
+  UniqueFunction(const UniqueFunction&) = delete;
+  UniqueFunction& operator=(const UniqueFunction&) = delete;
+
+  UniqueFunction(UniqueFunction&& other) noexcept
+    : vtable_(std::exchange(other.vtable_, nullptr))
+  {
+    if (vtable_) vtable_->relocate(other.storage_, storage_);
+  }
+
+  UniqueFunction& operator=(UniqueFunction&& other) noexcept {
+    if (this == &other) return *this;
+
+    reset();
+    vtable_ = std::exchange(other.vtable_, nullptr);
+    if (vtable_) vtable_->relocate(other.storage_, storage_);
+    return *this;
+  }
+
+  UniqueFunction& operator=(std::nullptr_t) noexcept {
+    reset();
+    return *this;
+  }
+
+  ~UniqueFunction() { reset(); }
+
+  void reset() noexcept {
+    if (vtable_) std::exchange(vtable_, nullptr)->destroy(storage_);
+  }
+
+  explicit operator bool() const noexcept { return vtable_ != nullptr; }
+
+  R operator()(Args... args) {
+    if (!vtable_) throw std::bad_function_call();
+    return vtable_->invoke(storage_, std::forward<Args>(args)...);
+  }
+};
+
+}  // namespace tpp
+
+#endif  // TOYPP_UNIQUEFUNCTION_HPP_
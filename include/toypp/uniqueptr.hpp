@@ -137,7 +137,10 @@ class UniquePtr {
               bool> = true>
   constexpr UniquePtr(const UniquePtr<U, E>&) noexcept = delete;
   constexpr UniquePtr(const UniquePtr&) noexcept = delete;
-  constexpr UniquePtr(UniquePtr&&) noexcept = default;
+  constexpr UniquePtr(UniquePtr&& other) noexcept
+    : ptr_(std::exchange(other.ptr_, nullptr))
+    , deleter_(std::forward<Deleter>(other.deleter_))
+  {}
 
   template <typename U, typename E,
             std::enable_if_t<
@@ -148,7 +151,12 @@ class UniquePtr {
               bool> = true>
   constexpr UniquePtr& operator=(const UniquePtr<U, E>&) noexcept = delete;
   constexpr UniquePtr& operator=(const UniquePtr&) noexcept = delete;
-  constexpr UniquePtr& operator=(UniquePtr&&) noexcept = default;
+  constexpr UniquePtr& operator=(UniquePtr&& other) noexcept
+  {
+    reset(other.release());
+    deleter_ = std::forward<Deleter>(other.deleter_);
+    return *this;
+  }
 
   ~UniquePtr() noexcept { deleter_(ptr_); }
 
@@ -0,0 +1,90 @@
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#endif
+
+#include <catch2/catch_all.hpp>
+
+#include "toypp/threaded/affinity.hpp"
+#include "toypp/threaded/threadpool.hpp"
+
+TEST_CASE("tpp::CpuTopology") {
+  SECTION("parse-cpu-list") {
+    using list = std::vector<int>;
+    REQUIRE(tpp::CpuTopology::parse_cpu_list("0") == list{0});
+    REQUIRE(tpp::CpuTopology::parse_cpu_list("0-3,8,10-11\n")
+            == list{0, 1, 2, 3, 8, 10, 11});
+    REQUIRE(tpp::CpuTopology::parse_cpu_list("").empty());
+  }
+
+  SECTION("assign") {
+    // two nodes with interleaved cpus, as on many 2 socket machines.
+    const tpp::CpuTopology topology{{{0, 2, 4, 6}, {1, 3, 5, 7}}};
+    CHECK(topology.nodes_count() == 2);
+    CHECK(topology.node_of(5) == 1);
+    CHECK(topology.node_of(42) == 0);
+
+    using list = std::vector<int>;
+    REQUIRE(topology.assign(tpp::Affinity::none, 3) == list{-1, -1, -1});
+    REQUIRE(topology.assign(tpp::Affinity::compact, 6)
+            == list{0, 2, 4, 6, 1, 3});
+    REQUIRE(topology.assign(tpp::Affinity::scatter, 6)
+            == list{0, 1, 2, 3, 4, 5});
+    REQUIRE(topology.assign(tpp::Affinity::explicit_cpus, 3, {7, 5})
+            == list{7, 5, 7});
+  }
+
+  SECTION("detect") {
+    const tpp::CpuTopology topology;
+    REQUIRE(topology.nodes_count() >= 1);
+    for (const auto& node : topology.nodes())
+      CHECK_FALSE(node.empty());
+  }
+}
+
+TEST_CASE("tpp::ThreadPool affinity") {
+  SECTION("pinned-workers") {
+    const tpp::CpuTopology topology;
+    const int cpu = topology.nodes().front().front();
+
+    tpp::ThreadPoolOptions options;
+    options.workers = 2;
+    options.affinity = tpp::Affinity::explicit_cpus;
+    options.cpus = {cpu};
+    tpp::ThreadPool pool{options};
+
+    std::atomic<int> ran_on{-2};
+    pool.submit([&] { ran_on = tpp::current_cpu(); }).get();
+#if defined(__linux__)
+    REQUIRE(ran_on == cpu);
+#endif
+
+    std::atomic<std::size_t> done{0};
+    for (int i = 0; i < 1'000; ++i)
+      pool.add_task([&] { ++done; });
+    pool.shutdown();
+    REQUIRE(done == 1'000);
+  }
+
+  SECTION("named-threads") {
+    tpp::ThreadPoolOptions options;
+    options.workers = 1;
+    options.name = "toypp-pool-with-long-name";
+    tpp::ThreadPool pool{options};
+
+    auto name = pool.submit([] {
+      char buffer[16] = {};
+#if defined(__linux__)
+      pthread_getname_np(pthread_self(), buffer, sizeof(buffer));
+#endif
+      return std::string(buffer);
+    }).get();
+#if defined(__linux__)
+    REQUIRE(name == "toypp-pool-with");
+#endif
+  }
+}
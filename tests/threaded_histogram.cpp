@@ -0,0 +1,28 @@
+#include <catch2/catch_all.hpp>
+
+#include "toypp/threaded/histogram.hpp"
+
+TEST_CASE("tpp::LatencyHistogram") {
+  tpp::LatencyHistogram histogram;
+  CHECK(histogram.count() == 0);
+  CHECK(histogram.percentile(50) == 0);
+
+  histogram.record(-5);  // clock skew lands in the first bucket.
+  histogram.record(0);
+  histogram.record(1);
+  histogram.record(1'000);  // [512, 1024)
+  histogram.record(1'500);  // [1024, 2048)
+
+  REQUIRE(histogram.count() == 5);
+  CHECK(histogram.bucket(0) == 3);
+  CHECK(histogram.bucket(9) == 1);
+  CHECK(histogram.bucket(10) == 1);
+  CHECK(tpp::LatencyHistogram::bucket_floor(10) == 1'024);
+
+  CHECK(histogram.percentile(50) == 2);
+  CHECK(histogram.percentile(80) == 1'024);
+  CHECK(histogram.percentile(100) == 2'048);
+
+  histogram.reset();
+  REQUIRE(histogram.count() == 0);
+}
@@ -0,0 +1,230 @@
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+
+#include "toypp/threaded/barrier.hpp"
+#include "toypp/threaded/latch.hpp"
+#include "toypp/threaded/threadpool.hpp"
+#include "toypp/threaded/waitgroup.hpp"
+
+using namespace std::chrono_literals;
+
+namespace {
+
+/// sums [begin, end) forking in halves down to `grain`, joining on a group.
+std::uint64_t fork_join_sum(tpp::ThreadPool& pool, std::uint64_t begin,
+                            std::uint64_t end, std::uint64_t grain) {
+  if (end - begin <= grain) {
+    std::uint64_t sum = 0;
+    for (auto i = begin; i < end; ++i) sum += i;
+    return sum;
+  }
+
+  const auto middle = begin + (end - begin) / 2;
+  std::uint64_t upper = 0;
+  tpp::WaitGroup group;
+  group.add();
+  pool.add_task([&] {
+    upper = fork_join_sum(pool, middle, end, grain);
+    group.done();
+  });
+  const auto lower = fork_join_sum(pool, begin, middle, grain);
+  group.wait(pool);
+  return lower + upper;
+}
+
+}  // namespace
+
+TEST_CASE("tpp::Latch") {
+  SECTION("counts-down") {
+    tpp::Latch latch{4};
+    std::atomic<int> arrived{0};
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 3; ++i) {
+      threads.emplace_back([&] {
+        ++arrived;
+        latch.count_down();
+      });
+    }
+
+    CHECK_FALSE(latch.try_wait());
+    std::this_thread::sleep_for(5ms);  // lets the last wait go to sleep.
+    std::thread last([&] { latch.arrive_and_wait(); });
+    latch.wait();
+    REQUIRE(arrived == 3);
+    REQUIRE(latch.try_wait());
+    CHECK(latch.count() == 0);
+
+    last.join();
+    for (auto& thread : threads) thread.join();
+  }
+
+  SECTION("waiting-worker-helps") {
+    tpp::ThreadPool pool{1};
+
+    // the only worker waits on tasks that only it could run.
+    auto done = pool.submit([&] {
+      std::atomic<int> count{0};
+      tpp::Latch latch{16};
+      for (int i = 0; i < 16; ++i) {
+        pool.add_task([&] {
+          ++count;
+          latch.count_down();
+        });
+      }
+      latch.wait(pool);
+      return count.load();
+    });
+    REQUIRE(done.get() == 16);
+  }
+}
+
+TEST_CASE("tpp::WaitGroup") {
+  SECTION("reuse") {
+    tpp::ThreadPool pool{2};
+    tpp::WaitGroup group;
+    std::atomic<int> count{0};
+
+    for (int round = 1; round <= 50; ++round) {
+      group.add(8);
+      for (int i = 0; i < 8; ++i) {
+        pool.add_task([&, i] {
+          if (i % 2) std::this_thread::yield();
+          ++count;
+          group.done();
+        });
+      }
+      if (round % 2)
+        group.wait();
+      else
+        group.wait(pool);
+      REQUIRE(count == round * 8);
+      REQUIRE(group.count() == 0);
+    }
+  }
+
+  SECTION("fork-join") {
+    tpp::ThreadPool pool{2};
+    constexpr std::uint64_t n = 100'000;
+    REQUIRE(fork_join_sum(pool, 0, n, 64) == n * (n - 1) / 2);
+
+    auto nested = pool.submit([&] { return fork_join_sum(pool, 0, n, 16); });
+    REQUIRE(nested.get() == n * (n - 1) / 2);
+  }
+
+  SECTION("group-gone-on-wake") {
+    tpp::ThreadPool pool{2};
+    for (int i = 0; i < 1'000; ++i) {
+      auto* group = new tpp::WaitGroup;
+      group->add();
+      pool.add_task([group] { group->done(); });
+      group->wait();
+      delete group;  // done() must not touch it after waking us.
+    }
+  }
+}
+
+TEST_CASE("tpp::Barrier") {
+  SECTION("phases") {
+    constexpr std::size_t count = 4;
+    constexpr std::size_t phases = 200;
+
+    std::vector<std::size_t> seen(count, 0);
+    std::size_t completions = 0;
+    bool in_step = true;
+    tpp::Barrier barrier{count, [&] {
+      for (auto value : seen)
+        in_step = in_step && value == completions + 1;
+      ++completions;
+    }};
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < count; ++i) {
+      threads.emplace_back([&, i] {
+        for (std::size_t phase = 0; phase < phases; ++phase) {
+          seen[i] = phase + 1;
+          if (phase % 16 == i) std::this_thread::sleep_for(50us);
+          barrier.arrive_and_wait();
+        }
+      });
+    }
+    for (auto& thread : threads) thread.join();
+
+    REQUIRE(completions == phases);
+    REQUIRE(in_step);
+    REQUIRE(barrier.phase() == phases);
+  }
+
+  SECTION("drop") {
+    std::atomic<int> completions{0};
+    tpp::Barrier barrier{3, [&] { ++completions; }};
+
+    std::thread leaver([&] {
+      barrier.arrive_and_wait();
+      barrier.arrive_and_drop();
+    });
+    std::thread stayer([&] {
+      for (int i = 0; i < 10; ++i) barrier.arrive_and_wait();
+    });
+    for (int i = 0; i < 10; ++i) barrier.arrive_and_wait();
+
+    stayer.join();
+    leaver.join();
+    REQUIRE(completions == 10);
+  }
+
+  SECTION("more-parties-than-workers") {
+    tpp::ThreadPool pool{2};
+    constexpr int parties = 6;
+
+    std::atomic<int> arrived{0};
+    std::atomic<int> early{0};  // left before all arrived.
+    tpp::Barrier barrier{parties};
+    tpp::Latch finished{parties};
+    for (int i = 0; i < parties; ++i) {
+      pool.add_task([&] {
+        ++arrived;
+        barrier.arrive_and_wait(pool);
+        if (arrived != parties) ++early;
+        finished.count_down();
+      });
+    }
+    finished.wait();
+    REQUIRE(early == 0);
+    REQUIRE(barrier.phase() == 1);
+  }
+}
+
+TEST_CASE("tpp::WaitGroup fork-join", "[.][benchmark]") {
+  tpp::ThreadPool pool{std::thread::hardware_concurrency()};
+  constexpr std::size_t tasks = 256;
+
+  BENCHMARK("counter and yield") {
+    std::atomic<std::size_t> pending{tasks};
+    for (std::size_t i = 0; i < tasks; ++i)
+      pool.add_task([&] { pending.fetch_sub(1); });
+    while (pending.load() != 0) {
+      if (!pool.run_pending_task()) std::this_thread::yield();
+    }
+    return pending.load();
+  };
+
+  BENCHMARK("wait group") {
+    tpp::WaitGroup group;
+    group.add(tasks);
+    for (std::size_t i = 0; i < tasks; ++i)
+      pool.add_task([&] { group.done(); });
+    group.wait(pool);
+    return group.count();
+  };
+
+  BENCHMARK("recursive wait group") {
+    return fork_join_sum(pool, 0, 1 << 16, 256);
+  };
+}
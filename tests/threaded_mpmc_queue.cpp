@@ -0,0 +1,71 @@
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+
+#include "toypp/threaded/mpmc_queue.hpp"
+
+TEST_CASE("tpp::MPMCQueue") {
+  SECTION("push-pop") {
+    tpp::MPMCQueue<std::string> queue{3};
+    CHECK(queue.capacity() == 4);
+    CHECK(queue.empty());
+
+    REQUIRE(queue.try_push("a"));
+    REQUIRE(queue.try_push(std::string("b")));
+    REQUIRE(queue.try_emplace(3, 'c'));
+    REQUIRE(queue.try_push("d"));
+    REQUIRE_FALSE(queue.try_push("full"));
+    CHECK(queue.size() == 4);
+
+    REQUIRE(queue.try_pop() == "a");
+    REQUIRE(queue.try_pop() == "b");
+    REQUIRE(queue.wait_pop() == "ccc");
+    REQUIRE(queue.try_push("e"));  // wraps around.
+    REQUIRE(queue.try_pop() == "d");
+    REQUIRE(queue.try_pop() == "e");
+    REQUIRE(queue.try_pop() == std::nullopt);
+  }
+
+  SECTION("destroys-leftovers") {
+    auto shared = std::make_shared<int>(42);
+    {
+      tpp::MPMCQueue<std::shared_ptr<int>> queue{8};
+      queue.push(shared);
+      queue.push(shared);
+      CHECK(shared.use_count() == 3);
+    }
+    REQUIRE(shared.use_count() == 1);
+  }
+
+  SECTION("multi-producer-multi-consumer") {
+    constexpr std::size_t count_max = 10'000;
+    constexpr std::size_t threads = 4;
+    tpp::MPMCQueue<std::size_t> queue{64};  // small, to hit full and empty.
+
+    std::atomic<std::size_t> consumer_sum{0};
+    std::vector<std::thread> producers;
+    std::vector<std::thread> consumers;
+
+    for (std::size_t i = 0; i < threads; ++i) {
+      producers.emplace_back([&] {
+        for (std::size_t n = 1; n <= count_max; ++n)
+          queue.push(n);
+      });
+      consumers.emplace_back([&] {
+        std::size_t sum = 0;
+        for (std::size_t n = 0; n < count_max; ++n)
+          sum += queue.wait_pop();
+        consumer_sum += sum;
+      });
+    }
+
+    for (auto& thread : producers) thread.join();
+    for (auto& thread : consumers) thread.join();
+
+    REQUIRE(consumer_sum == threads * count_max * (count_max + 1) / 2);
+    REQUIRE(queue.empty());
+  }
+}
@@ -0,0 +1,133 @@
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+
+#include "toypp/range.hpp"
+#include "toypp/threaded/parallel.hpp"
+
+TEST_CASE("tpp::parallel_for") {
+  tpp::ThreadPool pool{4};
+
+  SECTION("visits-each-once") {
+    std::vector<std::atomic<int>> visits(10'000);
+
+    tpp::parallel_for(pool, tpp::Range<int>(0, 10'000), [&](int i) {
+      ++visits[i];
+    });
+
+    for (const auto& visit : visits)
+      REQUIRE(visit == 1);
+  }
+
+  SECTION("steps") {
+    std::atomic<long long> sum{0};
+
+    tpp::parallel_for(pool, tpp::Range<int>(0, 100, 3), [&](int i) {
+      sum += i;
+    });
+    long long expected = 0;
+    for (int i = 0; i < 100; i += 3) expected += i;
+    REQUIRE(sum == expected);
+
+    sum = 0;
+    tpp::parallel_for(pool, tpp::Range<int>(10, 0, -1), [&](int i) {
+      sum += i;
+    }, 1);
+    REQUIRE(sum == 55);
+
+    tpp::parallel_for(pool, tpp::Range<int>(0, 0), [&](int) { sum = -1; });
+    REQUIRE(sum == 55);
+  }
+
+  SECTION("exceptions") {
+    auto fn = [&] {
+      tpp::parallel_for(pool, tpp::Range<int>(0, 1'000), [](int i) {
+        if (i == 500) throw std::runtime_error("500");
+      });
+    };
+    REQUIRE_THROWS_AS(fn(), std::runtime_error);
+  }
+
+  SECTION("foreign-task-throws") {
+    std::atomic<int> ended{0};
+    tpp::ThreadPoolOptions options;
+    options.workers = 1;
+    options.on_task_end = [&](std::size_t) { ++ended; };
+    tpp::ThreadPool single{options};
+
+    // keeps the worker busy, so the caller runs the queued tasks itself.
+    std::atomic<bool> started{false};
+    std::atomic<bool> release{false};
+    single.add_task([&] {
+      started = true;
+      while (!release) std::this_thread::yield();
+    });
+    while (!started) std::this_thread::yield();
+
+    single.add_task([] { throw std::logic_error("foreign"); });
+
+    std::vector<std::atomic<int>> visits(1'000);
+    auto fn = [&] {
+      tpp::parallel_for(single, tpp::Range<int>(0, 1'000), [&](int i) {
+        ++visits[i];
+      });
+    };
+    REQUIRE_THROWS_AS(fn(), std::logic_error);
+    for (const auto& visit : visits)
+      REQUIRE(visit == 1);
+
+    release = true;
+    single.shutdown();
+    REQUIRE(ended == 3);  // blocker, foreign and the spawned part.
+  }
+
+  SECTION("nested") {
+    std::atomic<int> count{0};
+
+    auto outer = pool.submit([&] {
+      tpp::parallel_for(pool, tpp::Range<int>(0, 8), [&](int) {
+        tpp::parallel_for(pool, tpp::Range<int>(0, 100), [&](int) {
+          ++count;
+        });
+      }, 1);
+    });
+    outer.get();
+
+    REQUIRE(count == 800);
+  }
+}
+
+TEST_CASE("tpp::parallel_reduce") {
+  tpp::ThreadPool pool{4};
+
+  SECTION("sum") {
+    const auto sum = tpp::parallel_reduce(
+        pool, tpp::Range<long long>(1, 100'001), 0LL,
+        [](long long acc, long long x) { return acc + x; },
+        [](long long a, long long b) { return a + b; });
+    REQUIRE(sum == 5'000'050'000LL);
+  }
+
+  SECTION("keeps-order") {
+    const auto str = tpp::parallel_reduce(
+        pool, tpp::Range<int>(0, 1'000), std::string{},
+        [](std::string acc, int x) { return acc + char('a' + x % 26); },
+        [](std::string a, const std::string& b) { return a + b; }, 7);
+
+    std::string expected;
+    for (int x = 0; x < 1'000; ++x) expected += char('a' + x % 26);
+    REQUIRE(str == expected);
+  }
+
+  SECTION("empty") {
+    const auto value = tpp::parallel_reduce(
+        pool, tpp::Range<int>(5, 5), 42,
+        [](int acc, int x) { return acc + x; },
+        [](int a, int b) { return a + b; });
+    REQUIRE(value == 42);
+  }
+}
@@ -1,9 +1,44 @@
+#include <atomic>
+#include <chrono>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
 #include <thread>
+#include <vector>
 
 #include <catch2/catch_all.hpp>
 
+#include "toypp/threaded/mpmc_queue.hpp"
 #include "toypp/threaded/queue.hpp"
 
+namespace {
+
+/// moves `count` values through `queue` with 4 producers and 4 consumers.
+template <typename Push, typename Pop>
+std::size_t transfer(std::size_t count, Push push, Pop pop) {
+  constexpr std::size_t threads = 4;
+  std::atomic<std::size_t> sum{0};
+  std::vector<std::thread> workers;
+
+  for (std::size_t i = 0; i < threads; ++i) {
+    workers.emplace_back([&] {
+      for (std::size_t n = 0; n < count / threads; ++n)
+        push(n);
+    });
+    workers.emplace_back([&] {
+      std::size_t local = 0;
+      for (std::size_t n = 0; n < count / threads; ++n)
+        local += pop();
+      sum += local;
+    });
+  }
+
+  for (auto& worker : workers) worker.join();
+  return sum;
+}
+
+}  // namespace
+
 TEST_CASE("tpp::MTQueue") {
   SECTION("push-pop") {
     tpp::MTQueue<int> queue{};
@@ -27,6 +62,76 @@ TEST_CASE("tpp::MTQueue") {
     REQUIRE(queue.pop() == std::nullopt);
   }
 
+  SECTION("emplace-and-clear") {
+    auto shared = std::make_shared<int>(42);
+    tpp::MTQueue<std::shared_ptr<int>> queue;
+
+    queue.emplace(shared);
+    queue.push(shared);
+    queue.push(shared);
+    CHECK(shared.use_count() == 4);
+
+    REQUIRE(queue.pop() == shared);
+    CHECK(shared.use_count() == 3);
+
+    queue.push(shared);  // into the popped node.
+    queue.clear();
+    CHECK(queue.size() == 0);
+    CHECK(shared.use_count() == 1);
+    REQUIRE(queue.pop() == std::nullopt);
+
+    queue.push(shared);
+    REQUIRE(queue.pop() == shared);
+  }
+
+  SECTION("throwing-push") {
+    struct Throwing {
+      int value = 0;
+      Throwing() = default;
+      explicit Throwing(int x) : value(x) {}
+      Throwing(const Throwing& other) : value(other.value) {
+        if (value < 0) throw std::runtime_error("negative");
+      }
+    };
+
+    tpp::MTQueue<Throwing> queue;
+    queue.emplace(1);
+    REQUIRE_THROWS_AS(queue.push(Throwing{-1}), std::runtime_error);
+    queue.emplace(2);
+
+    std::vector<Throwing> batch(3);
+    batch[1].value = -1;
+    REQUIRE_THROWS_AS(queue.push_range(batch.begin(), batch.end()),
+                      std::runtime_error);
+
+    CHECK(queue.size() == 2);
+    REQUIRE(queue.pop()->value == 1);
+    REQUIRE(queue.pop()->value == 2);
+    REQUIRE_FALSE(queue.pop());
+  }
+
+  SECTION("push-range-pop-bulk") {
+    tpp::MTQueue<int> queue;
+    std::vector<int> values(100);
+    for (int i = 0; i < 100; ++i) values[i] = i;
+
+    queue.push_range(values.begin(), values.end());
+    queue.push_range(values.end(), values.end());
+    CHECK(queue.size() == 100);
+
+    std::vector<int> popped;
+    CHECK(queue.pop_bulk(std::back_inserter(popped), 0) == 0);
+    CHECK(queue.pop_bulk(std::back_inserter(popped), 30) == 30);
+    CHECK(queue.size() == 70);
+    REQUIRE(queue.pop() == 30);
+    CHECK(queue.pop_bulk(std::back_inserter(popped), 1'000) == 69);
+    CHECK(queue.pop_bulk(std::back_inserter(popped), 1'000) == 0);
+    CHECK(queue.size() == 0);
+
+    values.erase(values.begin() + 30);
+    REQUIRE(popped == values);
+  }
+
   SECTION("single-producer-single-consumer") {
     constexpr std::size_t count_max = 10'000;
     tpp::MTQueue<std::size_t> queue;
@@ -38,15 +143,8 @@ TEST_CASE("tpp::MTQueue") {
     });
 
     std::thread consumer([&] {
-      std::optional<std::size_t> res;
-      std::this_thread::sleep_for(std::chrono::milliseconds(100));
       for (std::size_t i = 0; i < count_max; ++i) {
-        auto res = queue.pop();
-        // when consumer is faster, try stalling so producer would catch up.
-        for (int x = 0; !res && x < 4; ++x) {  
-          std::this_thread::sleep_for(std::chrono::milliseconds(10));
-          res = queue.pop();
-        }
+        auto res = queue.wait_pop();
         REQUIRE(res == i);
       }
     });
@@ -55,6 +153,35 @@ TEST_CASE("tpp::MTQueue") {
     consumer.join();
   }
 
+  SECTION("wait-pop-and-close") {
+    tpp::MTQueue<int> queue;
+
+    using namespace std::chrono_literals;
+    const auto start = std::chrono::steady_clock::now();
+    REQUIRE(queue.wait_pop_for(20ms) == std::nullopt);
+    CHECK(std::chrono::steady_clock::now() - start >= 20ms);
+
+    std::thread consumer([&] {
+      REQUIRE(queue.wait_pop() == 1);
+      REQUIRE(queue.wait_pop_for(10s) == 2);
+      REQUIRE(queue.wait_pop() == 3);
+      REQUIRE(queue.wait_pop() == std::nullopt);  // woken by close.
+    });
+
+    queue.push(1);
+    queue.push(2);
+    std::this_thread::sleep_for(10ms);  // likely waiting by now.
+    queue.push(3);
+    std::this_thread::sleep_for(10ms);
+    queue.close();
+    consumer.join();
+
+    CHECK(queue.closed());
+    queue.push(4);  // still accepted, but waiting doesn't block.
+    REQUIRE(queue.wait_pop() == 4);
+    REQUIRE(queue.wait_pop_for(10s) == std::nullopt);
+  }
+
   SECTION("multi-producer-multi-consumer") {
     tpp::MTQueue<std::size_t> queue;
     constexpr std::size_t count_max = 1'000;
@@ -70,16 +197,9 @@ TEST_CASE("tpp::MTQueue") {
     };
 
     auto consumer = [&] {
-      std::optional<std::size_t> res;
-      do {
-        res = queue.pop();
-        // when consumer is faster, try stalling so producer would catch up.
-        for (int x = 0; !res && x < 4; ++x) {  
-          std::this_thread::sleep_for(std::chrono::milliseconds(10));
-          res = queue.pop();
-        }
-        consumer_sum += res.value_or(0);
-      } while (res);
+      while (auto res = queue.wait_pop()) {
+        consumer_sum += *res;
+      }
     };
 
     std::vector<std::thread> producer_threads;
@@ -93,6 +213,7 @@ TEST_CASE("tpp::MTQueue") {
     for (auto& thread : producer_threads) {
         thread.join();
     }
+    queue.close();
     for (auto& thread : consumer_threads) {
         thread.join();
     }
@@ -100,3 +221,65 @@ TEST_CASE("tpp::MTQueue") {
     REQUIRE(producer_sum == consumer_sum);
   }
 }
+
+TEST_CASE("MPMC queue throughput", "[.][benchmark]") {
+  constexpr std::size_t count = 100'000;
+
+  BENCHMARK("tpp::MTQueue") {
+    tpp::MTQueue<std::size_t> queue;
+    return transfer(
+        count, [&](std::size_t n) { queue.push(n); },
+        [&] { return *queue.wait_pop(); });
+  };
+
+  BENCHMARK("tpp::MPMCQueue") {
+    tpp::MPMCQueue<std::size_t> queue{1024};
+    return transfer(
+        count, [&](std::size_t n) { queue.push(n); },
+        [&] { return queue.wait_pop(); });
+  };
+}
+
+TEST_CASE("tpp::MTQueue batching", "[.][benchmark]") {
+  constexpr std::size_t count = 100'000;
+  constexpr std::size_t batch = 64;
+
+  BENCHMARK("one at a time") {
+    tpp::MTQueue<std::size_t> queue;
+    std::thread producer([&] {
+      for (std::size_t i = 0; i < count; ++i) queue.push(i);
+    });
+
+    std::size_t sum = 0;
+    for (std::size_t i = 0; i < count; ++i) sum += *queue.wait_pop();
+    producer.join();
+    return sum;
+  };
+
+  BENCHMARK("push_range / pop_bulk") {
+    tpp::MTQueue<std::size_t> queue;
+    std::thread producer([&] {
+      std::vector<std::size_t> values(batch);
+      for (std::size_t i = 0; i < count; i += batch) {
+        for (std::size_t j = 0; j < batch; ++j) values[j] = i + j;
+        queue.push_range(values.begin(), values.end());
+      }
+    });
+
+    std::size_t sum = 0;
+    std::vector<std::size_t> values;
+    for (std::size_t popped = 0; popped < count;) {
+      values.clear();
+      const auto n = queue.pop_bulk(std::back_inserter(values), batch);
+      if (n == 0) {  // block for one instead of polling.
+        sum += *queue.wait_pop();
+        ++popped;
+        continue;
+      }
+      for (auto value : values) sum += value;
+      popped += n;
+    }
+    producer.join();
+    return sum;
+  };
+}
@@ -0,0 +1,96 @@
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+
+#include "toypp/threaded/rcucell.hpp"
+
+TEST_CASE("tpp::RcuCell") {
+  SECTION("publish-read") {
+    std::vector<std::string> reclaimed;
+    {
+      tpp::RcuCell<std::string> cell{
+          "a", 2, [&](std::string&& old) { reclaimed.push_back(old); }};
+      tpp::RcuCell<std::string>::Reader reader{cell};
+
+      REQUIRE(*reader.read() == "a");
+
+      cell.publish("b");
+      REQUIRE(reclaimed == std::vector<std::string>{"a"});
+
+      {
+        auto guard = reader.read();
+        REQUIRE(*guard == "b");
+
+        cell.update([](std::string& value) { value += "c"; });
+        cell.emplace(2, 'd');
+        REQUIRE(*guard == "b");  // still pinned.
+        REQUIRE(guard->size() == 1);
+        REQUIRE(cell.reclaim() == 2);  // "b" and "bc" wait for the guard.
+      }
+
+      REQUIRE(cell.reclaim() == 0);
+      REQUIRE(reclaimed == std::vector<std::string>{"a", "b", "bc"});
+      REQUIRE(*reader.read() == "dd");
+    }
+    REQUIRE(reclaimed == std::vector<std::string>{"a", "b", "bc", "dd"});
+  }
+
+  SECTION("reader-slots") {
+    tpp::RcuCell<int> cell{0, 1};
+    {
+      tpp::RcuCell<int>::Reader reader{cell};
+      REQUIRE_THROWS_AS(tpp::RcuCell<int>::Reader{cell}, std::length_error);
+    }
+    tpp::RcuCell<int>::Reader reader{cell};  // the slot was given back.
+    REQUIRE(*reader.read() == 0);
+  }
+
+  SECTION("many-readers") {
+    struct Value {
+      std::uint64_t a = 0;
+      std::uint64_t b = 0;
+    };
+    constexpr std::uint64_t count_max = 10'000;
+    constexpr std::size_t readers_count = 4;
+
+    std::atomic<std::uint64_t> reclaimed{0};
+    tpp::RcuCell<Value> cell{
+        Value{}, readers_count, [&](Value&&) { ++reclaimed; }};
+
+    std::atomic<bool> done{false};
+    std::atomic<std::size_t> torn{0};
+    std::atomic<std::size_t> backwards{0};
+    std::vector<std::thread> readers;
+    for (std::size_t i = 0; i < readers_count; ++i) {
+      readers.emplace_back([&] {
+        tpp::RcuCell<Value>::Reader reader{cell};
+        std::uint64_t last = 0;
+        while (!done) {
+          auto guard = reader.read();
+          torn += guard->a != guard->b;
+          backwards += guard->a < last;
+          last = guard->a;
+        }
+      });
+    }
+
+    for (std::uint64_t n = 1; n <= count_max; ++n) {
+      if (n % 2)
+        cell.publish(Value{n, n});
+      else
+        cell.update([n](Value& value) { value.a = value.b = n; });
+    }
+    done = true;
+    for (auto& thread : readers) thread.join();
+
+    REQUIRE(torn == 0);
+    REQUIRE(backwards == 0);
+    REQUIRE(cell.reclaim() == 0);
+    REQUIRE(reclaimed == count_max);
+  }
+}
@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+
+#include "toypp/threaded/semaphore.hpp"
+#include "toypp/threaded/spinsemaphore.hpp"
+
+using namespace std::chrono_literals;
+
+TEST_CASE("tpp::CountingSemaphore") {
+  SECTION("try-acquire") {
+    tpp::CountingSemaphore sem{3};
+    REQUIRE(sem.try_acquire());
+    REQUIRE(sem.try_acquire(2));
+    CHECK_FALSE(sem.try_acquire());
+    CHECK(sem.count() == 0);
+
+    sem.release(4);
+    CHECK_FALSE(sem.try_acquire(5));
+    REQUIRE(sem.try_acquire(4));
+
+    CHECK_FALSE(sem.try_acquire_for(1ms));
+    sem.release();
+    REQUIRE(sem.try_acquire_for(1ms));
+  }
+
+  SECTION("blocking") {
+    tpp::CountingSemaphore sem;
+    std::atomic<int> acquired{0};
+
+    std::thread single([&] {
+      sem.acquire();
+      ++acquired;
+    });
+    std::thread bulk([&] {
+      sem.acquire(3);
+      acquired += 3;
+    });
+
+    std::this_thread::sleep_for(10ms);  // lets them both go to sleep.
+    CHECK(acquired == 0);
+
+    sem.release(2);  // enough for the single one only.
+    while (acquired == 0) std::this_thread::yield();
+    single.join();
+    CHECK(acquired == 1);
+
+    for (int i = 0; i < 2; ++i) sem.release();
+    bulk.join();
+    REQUIRE(acquired == 4);
+    REQUIRE(sem.count() == 0);
+  }
+
+  SECTION("throttles") {
+    constexpr std::size_t limit = 3;
+    tpp::CountingSemaphore sem{limit};
+    std::atomic<std::size_t> in_flight{0};
+    std::atomic<std::size_t> peak{0};
+    std::atomic<std::size_t> timeouts{0};
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < 8; ++i) {
+      threads.emplace_back([&, i] {
+        for (std::size_t n = 0; n < 1'000; ++n) {
+          if (i % 2 == 0) {
+            sem.acquire();
+          } else if (!sem.try_acquire_for(100us)) {
+            ++timeouts;
+            continue;
+          }
+
+          const auto now = ++in_flight;
+          auto seen = peak.load();
+          while (now > seen && !peak.compare_exchange_weak(seen, now)) {}
+          if (n % 64 == 0) std::this_thread::yield();
+          --in_flight;
+          sem.release();
+        }
+      });
+    }
+    for (auto& thread : threads) thread.join();
+
+    REQUIRE(peak <= limit);
+    REQUIRE(sem.count() == limit);
+  }
+}
+
+TEST_CASE("tpp::SpinSemaphore") {
+  tpp::SpinSemaphore<2> sem;
+  CHECK(sem.max == 2);
+  sem.acquire();
+  REQUIRE(sem.try_acquire());
+  CHECK_FALSE(sem.try_acquire());
+  sem.release();
+  sem.release();
+  REQUIRE(sem.count() == 2);
+}
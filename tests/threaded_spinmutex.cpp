@@ -0,0 +1,336 @@
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+
+#include "toypp/threaded/adaptivemutex.hpp"
+#include "toypp/threaded/histogram.hpp"
+#include "toypp/threaded/mcsmutex.hpp"
+#include "toypp/threaded/spinmutex.hpp"
+#include "toypp/threaded/spinsharedmutex.hpp"
+#include "toypp/threaded/ticketmutex.hpp"
+
+namespace {
+
+/// each of `threads` threads increments a shared counter `count` times
+/// under `mutex`, returns the final counter.
+template <typename Mutex>
+auto hammer(Mutex& mutex, std::size_t threads, std::size_t count)
+    -> std::size_t
+{
+  std::size_t counter = 0;
+  std::vector<std::thread> workers;
+  for (std::size_t i = 0; i < threads; ++i) {
+    workers.emplace_back([&] {
+      for (std::size_t n = 0; n < count; ++n) {
+        std::lock_guard lk(mutex);
+        ++counter;
+      }
+    });
+  }
+  for (auto& worker : workers) worker.join();
+  return counter;
+}
+
+}  // namespace
+
+TEMPLATE_TEST_CASE("tpp spin locks", "", tpp::SpinMutex, tpp::TicketMutex,
+                   tpp::McsMutex, tpp::AdaptiveMutex,
+                   tpp::BasicSpinSharedMutex<true>,
+                   tpp::BasicSpinSharedMutex<false>) {
+  SECTION("lockable") {
+    TestType mutex;
+    {
+      std::unique_lock lk(mutex);
+      CHECK_FALSE(mutex.try_lock());
+    }
+    REQUIRE(mutex.try_lock());
+    mutex.unlock();
+
+    mutex.acquire();
+    CHECK_FALSE(mutex.try_lock());
+    mutex.release();
+  }
+
+  SECTION("nested") {
+    TestType outer;
+    TestType inner;
+    std::scoped_lock lk(outer, inner);
+    CHECK_FALSE(outer.try_lock());
+    CHECK_FALSE(inner.try_lock());
+  }
+
+  SECTION("mutual-exclusion") {
+    TestType mutex;
+    REQUIRE(hammer(mutex, 4, 10'000) == 40'000);
+  }
+}
+
+TEMPLATE_TEST_CASE("tpp::SpinSharedMutex", "",
+                   tpp::BasicSpinSharedMutex<true>,
+                   tpp::BasicSpinSharedMutex<false>) {
+  SECTION("shared") {
+    TestType mutex;
+    {
+      std::shared_lock first(mutex);
+      std::shared_lock second(mutex);
+      CHECK_FALSE(mutex.try_lock());
+    }
+    {
+      std::lock_guard lk(mutex);
+      CHECK_FALSE(mutex.try_lock_shared());
+    }
+    REQUIRE(mutex.try_lock_shared());
+    mutex.unlock_shared();
+  }
+
+  SECTION("readers-and-writers") {
+    TestType mutex;
+    std::size_t a = 0;
+    std::size_t b = 0;
+    std::atomic<std::size_t> torn{0};
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < 4; ++i) {
+      threads.emplace_back([&, i] {
+        for (std::size_t n = 0; n < 10'000; ++n) {
+          if (i == 0 || n % 16 == 0) {
+            std::lock_guard lk(mutex);
+            ++a;
+            ++b;
+          } else {
+            std::shared_lock lk(mutex);
+            torn += a != b;
+          }
+        }
+      });
+    }
+    for (auto& thread : threads) thread.join();
+
+    REQUIRE(torn == 0);
+    REQUIRE(a == 10'000 + 3 * 625);
+  }
+}
+
+TEST_CASE("tpp::SpinSharedMutex writer preference") {
+  tpp::SpinSharedMutex mutex;
+  mutex.lock_shared();
+
+  std::atomic<bool> locked{false};
+  std::thread writer([&] {
+    mutex.lock();
+    locked = true;
+    mutex.unlock();
+  });
+
+  // once the writer waits, new readers are kept out.
+  while (mutex.try_lock_shared()) {
+    mutex.unlock_shared();
+    std::this_thread::yield();
+  }
+  CHECK_FALSE(locked);
+
+  mutex.unlock_shared();
+  writer.join();
+  REQUIRE(locked);
+}
+
+TEST_CASE("tpp::McsMutex at thread exit") {
+  struct LocksAtExit {
+    tpp::McsMutex* mutex = nullptr;
+    int* count = nullptr;
+
+    ~LocksAtExit() {
+      if (!mutex) return;
+      std::lock_guard<tpp::McsMutex> lock{*mutex};
+      ++*count;
+    }
+  };
+
+  tpp::McsMutex mutex;
+  int count = 0;
+  std::thread([&] {
+    // made before the thread's node pool, so it's destroyed after it.
+    thread_local LocksAtExit at_exit;
+    at_exit.mutex = &mutex;
+    at_exit.count = &count;
+
+    std::lock_guard<tpp::McsMutex> lock{mutex};
+    ++count;
+  }).join();
+
+  REQUIRE(count == 2);
+}
+
+TEST_CASE("tpp::SpinMutex") {
+  SECTION("stats") {
+    tpp::BasicSpinMutex<true> mutex;
+    mutex.lock();
+    mutex.unlock();
+    REQUIRE(mutex.try_lock());
+    CHECK_FALSE(mutex.try_lock());
+    mutex.unlock();
+
+    auto stats = mutex.stats();
+    CHECK(stats.acquisitions == 2);
+    CHECK(stats.contended == 0);
+
+    mutex.lock();
+    std::thread waiter([&] {
+      mutex.lock();
+      mutex.unlock();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    mutex.unlock();
+    waiter.join();
+
+    stats = mutex.stats();
+    CHECK(stats.acquisitions == 4);
+    CHECK(stats.contended == 1);
+    CHECK(stats.spins > 0);
+
+    REQUIRE(hammer(mutex, 4, 10'000) == 40'000);
+    REQUIRE(mutex.stats().acquisitions == 40'004);
+  }
+}
+
+TEST_CASE("tpp::SpinMutex contention", "[.][benchmark]") {
+  constexpr std::size_t total = 1'000'000;
+
+  auto measure = [&](auto& mutex, std::size_t threads) {
+    const auto start = std::chrono::steady_clock::now();
+    hammer(mutex, threads, total / threads);
+    const std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count() / total;
+  };
+
+  for (std::size_t threads = 1; threads <= 64; threads *= 2) {
+    tpp::BasicSpinMutex<true> spin;
+    std::mutex mutex;
+    const auto spin_ns = measure(spin, threads);
+    const auto mutex_ns = measure(mutex, threads);
+    const auto stats = spin.stats();
+    WARN(threads << " threads: SpinMutex " << spin_ns << "ns/op ("
+         << 100.0 * stats.contended / stats.acquisitions << "% contended), "
+         << "std::mutex " << mutex_ns << "ns/op");
+  }
+}
+
+TEST_CASE("tpp spin locks tail latency", "[.][benchmark]") {
+  constexpr std::size_t threads = 8;
+  constexpr std::size_t count = 100'000;
+
+  auto measure = [&](const char* name, auto& mutex) {
+    tpp::LatencyHistogram waits;
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < threads; ++i) {
+      workers.emplace_back([&] {
+        for (std::size_t n = 0; n < count; ++n) {
+          const auto start = tpp::steady_clock_ns();
+          mutex.lock();
+          waits.record(tpp::steady_clock_ns() - start);
+          mutex.unlock();
+        }
+      });
+    }
+    for (auto& worker : workers) worker.join();
+
+    WARN(name << " lock wait p50 < " << waits.percentile(50)
+         << "ns, p99 < " << waits.percentile(99) << "ns, p99.9 < "
+         << waits.percentile(99.9) << "ns, p99.99 < "
+         << waits.percentile(99.99) << "ns");
+  };
+
+  tpp::SpinMutex spin;
+  measure("SpinMutex", spin);
+  tpp::TicketMutex ticket;
+  measure("TicketMutex", ticket);
+  tpp::McsMutex mcs;
+  measure("McsMutex", mcs);
+  std::mutex mutex;
+  measure("std::mutex", mutex);
+}
+
+TEST_CASE("tpp mutexes with mixed critical sections", "[.][benchmark]") {
+  constexpr std::size_t threads = 8;
+  constexpr std::size_t count = 50'000;
+
+  // mostly a few increments, now and then a long critical section.
+  auto measure = [&](const char* name, auto& mutex) {
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    std::size_t counter = 0;
+    for (std::size_t i = 0; i < threads; ++i) {
+      workers.emplace_back([&, i] {
+        std::mt19937 rng{static_cast<unsigned>(i)};
+        for (std::size_t n = 0; n < count; ++n) {
+          const auto work = rng() % 64 == 0 ? 2'000 : 10;
+          std::lock_guard lk(mutex);
+          for (int w = 0; w < work; ++w) {
+            ++counter;
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+          }
+        }
+      });
+    }
+    for (auto& worker : workers) worker.join();
+
+    const std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    WARN(name << ": " << elapsed.count() / (threads * count) << "ns/op");
+  };
+
+  tpp::SpinMutex spin;
+  measure("SpinMutex", spin);
+  tpp::AdaptiveMutex adaptive;
+  measure("AdaptiveMutex", adaptive);
+  std::mutex mutex;
+  measure("std::mutex", mutex);
+}
+
+TEST_CASE("tpp::SpinSharedMutex read-mostly", "[.][benchmark]") {
+  constexpr std::size_t threads = 8;
+  constexpr std::size_t count = 200'000;
+
+  // one write in 64 operations.
+  auto measure = [&](const char* name, auto& mutex) {
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    std::size_t value = 0;
+    std::atomic<std::size_t> sum{0};
+    for (std::size_t i = 0; i < threads; ++i) {
+      workers.emplace_back([&] {
+        std::size_t local = 0;
+        for (std::size_t n = 0; n < count; ++n) {
+          if (n % 64 == 0) {
+            std::lock_guard lk(mutex);
+            ++value;
+          } else {
+            std::shared_lock lk(mutex);
+            local += value;
+          }
+        }
+        sum += local;
+      });
+    }
+    for (auto& worker : workers) worker.join();
+
+    const std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    WARN(name << ": " << elapsed.count() / (threads * count) << "ns/op");
+  };
+
+  tpp::SpinSharedMutex spin;
+  measure("SpinSharedMutex", spin);
+  tpp::BasicSpinSharedMutex<false> readers_first;
+  measure("BasicSpinSharedMutex<false>", readers_first);
+  std::shared_mutex mutex;
+  measure("std::shared_mutex", mutex);
+}
@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+
+#include "toypp/threaded/queue.hpp"
+#include "toypp/threaded/spsc_queue.hpp"
+
+TEST_CASE("tpp::SPSCQueue") {
+  SECTION("push-pop") {
+    tpp::SPSCQueue<std::string, 4> queue;
+    CHECK(queue.capacity() == 4);
+    CHECK(queue.empty());
+    CHECK(queue.front() == nullptr);
+
+    REQUIRE(queue.try_push("a"));
+    REQUIRE(queue.try_push(std::string("b")));
+    REQUIRE(queue.try_emplace(3, 'c'));
+    REQUIRE(queue.try_push("e"));
+    REQUIRE_FALSE(queue.try_push("full"));
+    CHECK(queue.size() == 4);
+
+    REQUIRE(*queue.front() == "a");
+    queue.pop();
+    REQUIRE(queue.try_pop() == "b");
+    REQUIRE(queue.try_push("d"));  // wraps around.
+    REQUIRE(queue.try_pop() == "ccc");
+    REQUIRE(queue.try_pop() == "e");
+    REQUIRE(queue.try_pop() == "d");
+    REQUIRE(queue.try_pop() == std::nullopt);
+  }
+
+  SECTION("push-n-pop-n") {
+    tpp::SPSCQueue<int, 8> queue;
+    const std::vector<int> in = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+    CHECK(queue.push_n(in.begin(), in.size()) == 8);  // full.
+    CHECK(queue.push_n(in.begin(), 1) == 0);
+
+    std::vector<int> out;
+    CHECK(queue.pop_n(std::back_inserter(out), 3) == 3);
+    REQUIRE(out == std::vector<int>{1, 2, 3});
+
+    CHECK(queue.push_n(in.begin() + 8, 3) == 3);  // wraps around.
+    CHECK(queue.pop_n(std::back_inserter(out), 10) == 8);
+    REQUIRE(out == in);
+    CHECK(queue.pop_n(std::back_inserter(out), 10) == 0);
+  }
+
+  SECTION("destroys-leftovers") {
+    auto shared = std::make_shared<int>(42);
+    {
+      tpp::SPSCQueue<std::shared_ptr<int>, 8> queue;
+      REQUIRE(queue.try_push(shared));
+      REQUIRE(queue.try_push(shared));
+      CHECK(shared.use_count() == 3);
+    }
+    REQUIRE(shared.use_count() == 1);
+  }
+
+  SECTION("single-producer-single-consumer") {
+    constexpr std::size_t count_max = 100'000;
+    tpp::SPSCQueue<std::size_t, 64> queue;  // small, to hit full and empty.
+
+    std::thread producer([&] {
+      std::size_t buffer[16];
+      for (std::size_t n = 0; n < count_max;) {
+        if (n % 3 == 0) {  // mixes single and batched pushes.
+          if (queue.try_push(n)) ++n;
+          else std::this_thread::yield();
+          continue;
+        }
+
+        const auto count = std::min<std::size_t>(16, count_max - n);
+        for (std::size_t i = 0; i < count; ++i) buffer[i] = n + i;
+        const auto pushed = queue.push_n(buffer, count);
+        if (pushed == 0) std::this_thread::yield();
+        n += pushed;
+      }
+    });
+
+    std::size_t expected = 0;
+    std::size_t mismatches = 0;
+    std::size_t buffer[16];
+    while (expected < count_max) {
+      if (expected % 2 == 0) {
+        if (const auto* value = queue.front()) {
+          mismatches += *value != expected++;
+          queue.pop();
+        } else {
+          std::this_thread::yield();
+        }
+        continue;
+      }
+
+      const auto count = queue.pop_n(buffer, 16);
+      if (count == 0) std::this_thread::yield();
+      for (std::size_t i = 0; i < count; ++i)
+        mismatches += buffer[i] != expected++;
+    }
+    producer.join();
+
+    REQUIRE(mismatches == 0);
+    REQUIRE(queue.empty());
+  }
+}
+
+TEST_CASE("tpp::SPSCQueue throughput", "[.][benchmark]") {
+  constexpr std::size_t total = 10'000'000;
+
+  auto report = [](const char* name, auto start) {
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    WARN(name << ": " << total / elapsed.count() / 1e6 << " M items/s");
+  };
+
+  {
+    tpp::SPSCQueue<std::size_t, 1024> queue;
+    const auto start = std::chrono::steady_clock::now();
+    std::thread producer([&] {
+      for (std::size_t n = 0; n < total;) {
+        if (queue.try_push(n)) ++n;
+        else std::this_thread::yield();
+      }
+    });
+    for (std::size_t n = 0; n < total;) {
+      if (queue.try_pop()) ++n;
+      else std::this_thread::yield();
+    }
+    producer.join();
+    report("SPSCQueue", start);
+  }
+
+  {
+    tpp::SPSCQueue<std::size_t, 1024> queue;
+    const auto start = std::chrono::steady_clock::now();
+    std::thread producer([&] {
+      std::vector<std::size_t> batch(64);
+      for (std::size_t n = 0; n < total;) {
+        const auto pushed = queue.push_n(batch.begin(),
+                                         std::min(batch.size(), total - n));
+        if (pushed == 0) std::this_thread::yield();
+        n += pushed;
+      }
+    });
+    std::vector<std::size_t> batch(64);
+    for (std::size_t n = 0; n < total;) {
+      const auto popped = queue.pop_n(batch.begin(), batch.size());
+      if (popped == 0) std::this_thread::yield();
+      n += popped;
+    }
+    producer.join();
+    report("SPSCQueue batches of 64", start);
+  }
+
+  {
+    tpp::MTQueue<std::size_t> queue;
+    const auto start = std::chrono::steady_clock::now();
+    std::thread producer([&] {
+      for (std::size_t n = 0; n < total; ++n) queue.push(n);
+    });
+    for (std::size_t n = 0; n < total; ++n) (void)queue.wait_pop();
+    producer.join();
+    report("MTQueue", start);
+  }
+}
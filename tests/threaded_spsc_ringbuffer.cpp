@@ -1,9 +1,290 @@
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <random>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include <catch2/catch_all.hpp>
 
 #include "toypp/threaded/spsc_ringbuffer.hpp"
 
 TEST_CASE("tpp::SPSCRingBuffer") {
-    //
+  SECTION("read-write") {
+    tpp::SPSCRingBuffer ring{6};
+    CHECK(ring.capacity() == 8);
+    CHECK(ring.size() == 0);
+
+    char out[16] = {};
+    CHECK(ring.read(out, sizeof(out)) == 0);
+
+    CHECK(ring.write("abcde", 5) == 5);
+    CHECK(ring.write("fghij", 5) == 3);  // full.
+    CHECK(ring.write("x", 1) == 0);
+    CHECK(ring.size() == 8);
+
+    CHECK(ring.read(out, 3) == 3);
+    REQUIRE(std::string(out, 3) == "abc");
+
+    CHECK(ring.write("ijk", 3) == 3);  // wraps around.
+    CHECK(ring.read(out, sizeof(out)) == 8);
+    REQUIRE(std::string(out, 8) == "defghijk");
+    CHECK(ring.size() == 0);
+  }
+
+  SECTION("in-place") {
+    tpp::SPSCRingBuffer ring{8};
+    CHECK(ring.peek_read().empty());
+
+    auto span = ring.prepare_write(5);
+    REQUIRE(span.size() == 5);
+    std::memcpy(span.data(), "abcde", 5);
+    CHECK(ring.size() == 0);  // not committed yet.
+    ring.commit_write(5);
+    CHECK(ring.size() == 5);
+
+    CHECK(ring.prepare_write(8).size() == 3);  // only 3 are free.
+
+    span = ring.peek_read();
+    REQUIRE(std::string(span.data(), span.size()) == "abcde");
+    ring.consume(3);
+    CHECK(ring.size() == 2);
+
+    // 6 are free, but only 3 until the end of the buffer.
+    span = ring.prepare_write(6);
+    REQUIRE(span.size() == 3);
+    std::memcpy(span.data(), "fgh", 3);
+    ring.commit_write(3);
+
+    span = ring.prepare_write(3);
+    REQUIRE(span.size() == 3);
+    std::memcpy(span.data(), "ijk", 3);
+    ring.commit_write(2);  // commits less than prepared.
+
+    span = ring.peek_read();
+    REQUIRE(std::string(span.data(), span.size()) == "defgh");
+    ring.consume(span.size());
+
+    span = ring.peek_read();
+    REQUIRE(std::string(span.data(), span.size()) == "ij");
+    ring.consume(span.size());
+    CHECK(ring.size() == 0);
+  }
+
+  SECTION("stress") {
+    constexpr std::size_t total = 4 << 20;
+    tpp::SPSCRingBuffer ring{1000};
+
+    auto byte_at = [](std::size_t i) { return static_cast<char>(i % 251); };
+
+    std::thread producer([&] {
+      std::mt19937 rng{1};
+      std::vector<char> chunk(3000);
+      for (std::size_t sent = 0; sent < total;) {
+        const auto size = std::min<std::size_t>(rng() % chunk.size() + 1,
+                                                total - sent);
+        for (std::size_t i = 0; i < size; ++i) chunk[i] = byte_at(sent + i);
+
+        for (std::size_t done = 0; done < size;) {
+          const auto count = ring.write(chunk.data() + done, size - done);
+          if (count == 0) std::this_thread::yield();
+          done += count;
+        }
+        sent += size;
+      }
+    });
+
+    std::mt19937 rng{2};
+    std::vector<char> chunk(3000);
+    std::size_t received = 0;
+    std::size_t mismatches = 0;
+    while (received < total) {
+      const auto count = ring.read(chunk.data(), rng() % chunk.size() + 1);
+      if (count == 0) std::this_thread::yield();
+      for (std::size_t i = 0; i < count; ++i)
+        mismatches += chunk[i] != byte_at(received + i);
+      received += count;
+    }
+    producer.join();
+
+    REQUIRE(mismatches == 0);
+    REQUIRE(ring.size() == 0);
+  }
+
+  SECTION("in-place-stress") {
+    constexpr std::size_t total = 4 << 20;
+    tpp::SPSCRingBuffer ring{1000};
+
+    auto byte_at = [](std::size_t i) { return static_cast<char>(i % 251); };
+
+    std::thread producer([&] {
+      std::mt19937 rng{1};
+      for (std::size_t sent = 0; sent < total;) {
+        const auto span = ring.prepare_write(
+            std::min<std::size_t>(rng() % 3000 + 1, total - sent));
+        if (span.empty()) std::this_thread::yield();
+        for (std::size_t i = 0; i < span.size(); ++i)
+          span[i] = byte_at(sent + i);
+        ring.commit_write(span.size());
+        sent += span.size();
+      }
+    });
+
+    std::mt19937 rng{2};
+    std::size_t received = 0;
+    std::size_t mismatches = 0;
+    while (received < total) {
+      const auto span = ring.peek_read();
+      if (span.empty()) std::this_thread::yield();
+      const auto count = std::min<std::size_t>(rng() % 3000 + 1, span.size());
+      for (std::size_t i = 0; i < count; ++i)
+        mismatches += span[i] != byte_at(received + i);
+      ring.consume(count);
+      received += count;
+    }
+    producer.join();
+
+    REQUIRE(mismatches == 0);
+    REQUIRE(ring.size() == 0);
+  }
+
+  SECTION("wait-readable") {
+    tpp::SPSCRingBuffer ring{64};
+    using namespace std::chrono_literals;
+    CHECK_FALSE(ring.wait_readable_for(1, 1ms));
+
+    CHECK(ring.write("ab", 2) == 2);
+    ring.wait_readable(2);
+    CHECK(ring.wait_readable_for(2, 0ms));
+    CHECK_FALSE(ring.wait_readable_for(3, 1ms));
+
+    std::thread producer([&] {
+      std::this_thread::sleep_for(10ms);
+      auto span = ring.prepare_write(2);
+      std::memcpy(span.data(), "cd", 2);
+      ring.commit_write(2);
+    });
+    ring.wait_readable(4);
+    producer.join();
+
+    char out[4] = {};
+    CHECK(ring.read(out, sizeof(out)) == 4);
+    REQUIRE(std::string(out, 4) == "abcd");
+
+    // more than fits waits for a full buffer, instead of forever.
+    const std::string full(ring.capacity(), 'x');
+    CHECK(ring.write(full.data(), full.size() - 1) == full.size() - 1);
+    CHECK_FALSE(ring.wait_readable_for(ring.capacity() + 1, 1ms));
+    CHECK(ring.write(full.data(), 1) == 1);
+    CHECK(ring.wait_readable_for(ring.capacity() + 1, 0ms));
+    ring.wait_readable(ring.capacity() * 2);
+  }
+
+  SECTION("blocking-stress") {
+    constexpr std::size_t total = 1 << 20;
+    tpp::SPSCRingBuffer ring{256};
+
+    std::thread producer([&] {
+      std::mt19937 rng{1};
+      std::vector<char> chunk(64);
+      for (std::size_t sent = 0; sent < total;) {
+        const auto size = std::min<std::size_t>(rng() % chunk.size() + 1,
+                                                total - sent);
+        for (std::size_t i = 0; i < size; ++i)
+          chunk[i] = static_cast<char>((sent + i) % 251);
+
+        for (std::size_t done = 0; done < size;) {
+          const auto count = ring.write(chunk.data() + done, size - done);
+          if (count == 0) std::this_thread::yield();
+          done += count;
+        }
+        sent += size;
+        if (rng() % 64 == 0)  // makes the consumer park now and then.
+          std::this_thread::sleep_for(std::chrono::microseconds(50));
+      }
+    });
+
+    std::size_t received = 0;
+    std::size_t mismatches = 0;
+    std::vector<char> chunk(128);
+    while (received < total) {
+      ring.wait_readable();
+      const auto count = ring.read(chunk.data(), chunk.size());
+      mismatches += count == 0;
+      for (std::size_t i = 0; i < count; ++i)
+        mismatches += chunk[i] != static_cast<char>((received + i) % 251);
+      received += count;
+    }
+    producer.join();
+
+    REQUIRE(mismatches == 0);
+  }
+
+#if defined(__linux__)
+  SECTION("mirrored") {
+    tpp::SPSCRingBuffer ring{100, true};
+    REQUIRE(ring.mirrored());
+    const auto capacity = ring.capacity();
+    CHECK(capacity >= 4096);
+    CHECK((capacity & (capacity - 1)) == 0);
+
+    // moves head and tail to 3 bytes before the end.
+    std::vector<char> filler(capacity - 3);
+    CHECK(ring.write(filler.data(), filler.size()) == filler.size());
+    CHECK(ring.read(filler.data(), filler.size()) == filler.size());
+
+    auto span = ring.prepare_write(8);
+    REQUIRE(span.size() == 8);  // wraps around, but still one span.
+    std::memcpy(span.data(), "abcdefgh", 8);
+    ring.commit_write(8);
+
+    span = ring.peek_read();
+    REQUIRE(std::string(span.data(), span.size()) == "abcdefgh");
+    ring.consume(2);
+
+    char out[8] = {};
+    CHECK(ring.write("ij", 2) == 2);
+    CHECK(ring.read(out, sizeof(out)) == 8);
+    REQUIRE(std::string(out, 8) == "cdefghij");
+  }
+#endif
+}
+
+TEST_CASE("tpp::SPSCRingBuffer throughput", "[.][benchmark]") {
+  constexpr std::size_t total = std::size_t{1} << 30;
+
+#if defined(__linux__)
+  const auto modes = {false, true};
+#else
+  const auto modes = {false};
+#endif
+
+  for (const bool mirrored : modes)
+  for (const std::size_t chunk_size : {64, 4096}) {
+    tpp::SPSCRingBuffer ring{1 << 20, mirrored};
+    const auto start = std::chrono::steady_clock::now();
+
+    std::thread producer([&] {
+      std::vector<char> chunk(chunk_size, 'x');
+      for (std::size_t sent = 0; sent < total;) {
+        const auto count = ring.write(chunk.data(), chunk.size());
+        if (count == 0) std::this_thread::yield();
+        sent += count;
+      }
+    });
+
+    std::vector<char> chunk(chunk_size);
+    for (std::size_t received = 0; received < total;) {
+      const auto count = ring.read(chunk.data(), chunk.size());
+      if (count == 0) std::this_thread::yield();
+      received += count;
+    }
+    producer.join();
+
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    WARN((mirrored ? "mirrored, " : "") << chunk_size << " byte chunks: "
+         << total / elapsed.count() / 1e9 << " GB/s");
+  }
 }
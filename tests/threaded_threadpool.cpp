@@ -0,0 +1,401 @@
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+
+#include "toypp/threaded/threadpool.hpp"
+#include "toypp/uniqueptr.hpp"
+
+namespace {
+
+void wait_until(const std::atomic<std::size_t>& counter, std::size_t value) {
+  while (counter.load() < value)
+    std::this_thread::yield();
+}
+
+}  // namespace
+
+TEST_CASE("tpp::ThreadPool") {
+  SECTION("runs-all-tasks") {
+    constexpr std::size_t count_max = 10'000;
+    std::atomic<std::size_t> done{0};
+
+    tpp::ThreadPool pool{4};
+    CHECK(pool.workers_count() == 4);
+    CHECK(pool.running());
+
+    for (std::size_t i = 0; i < count_max; ++i)
+      pool.add_task([&] { ++done; });
+
+    wait_until(done, count_max);
+    REQUIRE(done == count_max);
+  }
+
+  SECTION("nested-tasks") {
+    constexpr std::size_t fanout = 16;
+    std::atomic<std::size_t> done{0};
+
+    tpp::ThreadPool pool{4};
+    for (std::size_t i = 0; i < fanout; ++i) {
+      pool.add_task([&] {
+        for (std::size_t j = 0; j < fanout; ++j)
+          pool.add_task([&] { ++done; });
+      });
+    }
+
+    wait_until(done, fanout * fanout);
+    REQUIRE(done == fanout * fanout);
+  }
+
+  SECTION("move-only-tasks") {
+    std::atomic<std::size_t> done{0};
+
+    tpp::ThreadPool pool{2};
+    for (std::size_t i = 0; i < 100; ++i) {
+      auto value = tpp::make_unique<std::size_t>(i);
+      pool.add_task([&done, value = std::move(value)] { done += *value; });
+    }
+
+    auto doubled = pool.submit(
+        [](tpp::UniquePtr<int> value) { return *value * 2; },
+        tpp::make_unique<int>(21));
+    REQUIRE(doubled.get() == 42);
+
+    wait_until(done, 99 * 100 / 2);
+    REQUIRE(done == 99 * 100 / 2);
+  }
+
+  SECTION("add-tasks") {
+    constexpr std::size_t count_max = 1'000;
+    std::atomic<std::size_t> done{0};
+
+    std::vector<tpp::ThreadPool::task_type> tasks;
+    for (std::size_t i = 0; i < count_max; ++i)
+      tasks.emplace_back([&] { ++done; });
+
+    tpp::ThreadPool pool{4};
+    pool.add_tasks(std::make_move_iterator(tasks.begin()),
+                   std::make_move_iterator(tasks.end()));
+    wait_until(done, count_max);
+
+    // from within a worker, into its own deque.
+    pool.add_task([&] {
+      std::vector<std::function<void()>> nested(count_max, [&] { ++done; });
+      pool.add_tasks(nested.begin(), nested.end());
+    });
+    wait_until(done, 2 * count_max);
+
+    REQUIRE(done == 2 * count_max);
+  }
+
+  SECTION("add-tasks-throwing") {
+    std::atomic<std::size_t> done{0};
+
+    // its third copy throws, after two tasks are queued.
+    struct Task {
+      std::atomic<std::size_t>* done;
+      std::size_t index;
+
+      Task(std::atomic<std::size_t>* d, std::size_t i) : done(d), index(i) {}
+      Task(const Task& other) : done(other.done), index(other.index) {
+        if (index == 2) throw std::runtime_error("copy");
+      }
+      void operator()() { ++*done; }
+    };
+    std::vector<Task> tasks;
+    tasks.reserve(4);
+    for (std::size_t i = 0; i < 4; ++i) tasks.emplace_back(&done, i);
+
+    tpp::ThreadPoolOptions options;
+    options.workers = 2;
+    options.idle.spins = 0;
+    options.idle.yields = 0;
+    tpp::ThreadPool pool{options};
+    while (pool.idle_workers() != 2)
+      std::this_thread::yield();
+
+    // the queued ones still wake the parked workers.
+    REQUIRE_THROWS_AS(pool.add_tasks(tasks.begin(), tasks.end()),
+                      std::runtime_error);
+    wait_until(done, 2);
+    REQUIRE(done == 2);
+  }
+
+  SECTION("graceful-shutdown") {
+    std::atomic<std::size_t> done{0};
+
+    tpp::ThreadPool pool{2};
+    for (int i = 0; i < 100; ++i) {
+      pool.add_task([&] {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        pool.add_task([&] { ++done; });
+      });
+    }
+
+    pool.shutdown();
+    CHECK_FALSE(pool.running());
+    CHECK(pool.workers_count() == 0);
+    CHECK(pool.jobs_count() == 0);
+    REQUIRE(done == 100);
+
+    // the workers' final stats outlive them.
+    REQUIRE(pool.worker_stats(0).tasks + pool.worker_stats(1).tasks == 200);
+  }
+
+  SECTION("force-shutdown") {
+    std::atomic<std::size_t> done{0};
+
+    tpp::ThreadPool pool{1};
+    for (int i = 0; i < 100; ++i) {
+      pool.add_task([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        ++done;
+      });
+    }
+
+    pool.force_shutdown();
+    CHECK_FALSE(pool.running());
+    REQUIRE(done < 100);
+  }
+
+  SECTION("submit") {
+    tpp::ThreadPool pool{2};
+
+    auto sum = pool.submit([](int a, int b) { return a + b; }, 40, 2);
+    auto nothing = pool.submit([] {});
+    auto error = pool.submit([]() -> int { throw std::runtime_error("x"); });
+    auto nested = pool.submit([&pool] {
+      return pool.submit([] { return std::string("nested"); }).get();
+    });
+
+    REQUIRE(sum.valid());
+    REQUIRE(sum.get() == 42);
+    CHECK_FALSE(sum.valid());
+
+    nothing.wait();
+    CHECK(nothing.ready());
+    nothing.get();
+
+    REQUIRE_THROWS_AS(error.get(), std::runtime_error);
+    REQUIRE(nested.get() == "nested");
+
+    int target = 1;
+    auto reference = pool.submit([&]() -> int& { return target; });
+    int& result = reference.get();
+    CHECK(&result == &target);
+
+    auto first = pool.submit([] { return 1; });
+    auto second = pool.submit([] { return 2; });
+    first = std::move(second);
+    CHECK_FALSE(second.valid());
+    REQUIRE(first.get() == 2);
+  }
+
+  SECTION("submit-dropped-by-force-shutdown") {
+    tpp::ThreadPool pool{1};
+
+    std::atomic<std::size_t> started{0};
+    auto blocker = pool.submit([&] {
+      ++started;
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    });
+    auto dropped = pool.submit([] { return 1; });
+
+    wait_until(started, 1);
+    pool.force_shutdown();
+    blocker.get();
+
+    CHECK(dropped.ready());
+    REQUIRE_THROWS_AS(dropped.get(), std::future_error);
+  }
+
+  SECTION("idle-policy") {
+    tpp::ThreadPoolOptions options;
+    options.workers = 2;
+    options.idle.spins = 0;
+    options.idle.yields = 0;
+    tpp::ThreadPool parking{options};
+
+    while (parking.idle_workers() != 2)
+      std::this_thread::yield();
+
+    REQUIRE(parking.submit([] { return 1; }).get() == 1);
+    REQUIRE(parking.wakeup_latency().count() >= 1);
+
+    options.idle.spins = 1 << 16;
+    options.idle.yields = 16;
+    tpp::ThreadPool spinning{options};
+
+    std::atomic<std::size_t> done{0};
+    for (int i = 0; i < 1'000; ++i) {
+      spinning.add_task([&] { ++done; });
+      if (i % 100 == 0) std::this_thread::yield();
+    }
+    wait_until(done, 1'000);
+  }
+
+  SECTION("stats-and-hooks") {
+    std::atomic<std::size_t> begins{0};
+    std::atomic<std::size_t> ends{0};
+    std::atomic<std::size_t> external{0};
+
+    tpp::ThreadPoolOptions options;
+    options.workers = 2;
+    options.timing = true;
+    options.on_task_begin = [&](std::size_t worker) {
+      ++begins;
+      if (worker == tpp::ThreadPool::no_worker) ++external;
+    };
+    options.on_task_end = [&](std::size_t) { ++ends; };
+    tpp::ThreadPool pool{options};
+
+    constexpr std::size_t count = 1'000;
+    std::atomic<std::size_t> done{0};
+    std::vector<std::function<void()>> tasks(count, [&] { ++done; });
+    pool.add_tasks(tasks.begin(), tasks.end());
+
+    // the calling thread may help too; those tasks count as no_worker.
+    while (pool.run_pending_task()) {}
+    wait_until(done, count);
+    wait_until(ends, count);
+
+    CHECK(begins == count);
+    CHECK(pool.queue_high_water() >= 1);
+    CHECK(pool.queue_high_water() <= count);
+    CHECK(pool.queue_latency().count() == count);
+
+    std::size_t tasks_run = 0;
+    for (std::size_t i = 0; i < pool.workers_count(); ++i) {
+      const auto stats = pool.worker_stats(i);
+      tasks_run += stats.tasks;
+      CHECK(stats.busy_ns >= 0);
+      CHECK(stats.idle_ns >= 0);
+    }
+    REQUIRE(tasks_run + external == count);
+  }
+
+  SECTION("priorities") {
+    using Priority = tpp::ThreadPool::Priority;
+    tpp::ThreadPool pool{1};
+
+    std::atomic<bool> release{false};
+    std::atomic<std::size_t> done{0};
+    pool.add_task([&] {
+      while (!release) std::this_thread::yield();
+    });
+
+    std::vector<char> order;  // only touched by the single worker.
+    auto record = [&](char c) {
+      return [&order, &done, c] { order.push_back(c); ++done; };
+    };
+    pool.add_task(record('b'), Priority::background);
+    pool.add_task(record('n'));
+    pool.add_task(record('h'), Priority::high);
+    auto future = pool.submit(Priority::high, [] { return 42; });
+
+    release = true;
+    wait_until(done, 3);
+    REQUIRE(future.get() == 42);
+    REQUIRE(order == std::vector<char>{'h', 'n', 'b'});
+  }
+
+  SECTION("background-not-starved") {
+    using Priority = tpp::ThreadPool::Priority;
+    constexpr std::size_t count = 4 * tpp::ThreadPool::background_turn;
+    tpp::ThreadPool pool{1};
+
+    std::atomic<bool> release{false};
+    std::atomic<std::size_t> done{0};
+    pool.add_task([&] {
+      while (!release) std::this_thread::yield();
+    });
+
+    std::size_t background_at = 0;
+    pool.add_task([&] { background_at = done++; }, Priority::background);
+    for (std::size_t i = 0; i < count; ++i)
+      pool.add_task([&] { ++done; });
+
+    release = true;
+    wait_until(done, count + 1);
+    REQUIRE(background_at <= tpp::ThreadPool::background_turn);
+  }
+}
+
+TEST_CASE("tpp::ThreadPool fan-out scaling", "[.][benchmark]") {
+  constexpr std::size_t fanout = 32;
+  constexpr std::size_t leaves = fanout * fanout;
+
+  const std::size_t max_workers = std::thread::hardware_concurrency();
+  for (std::size_t workers = 1; workers <= max_workers; workers *= 2) {
+    tpp::ThreadPool pool{workers};
+
+    BENCHMARK("fan-out with " + std::to_string(workers) + " workers") {
+      std::atomic<std::size_t> done{0};
+      for (std::size_t i = 0; i < fanout; ++i) {
+        pool.add_task([&] {
+          for (std::size_t j = 0; j < fanout; ++j) {
+            pool.add_task([&] {
+              volatile std::size_t sink = 0;
+              for (std::size_t k = 0; k < 2'000; ++k) sink = sink + k;
+              ++done;
+            });
+          }
+        });
+      }
+      wait_until(done, leaves);
+      return done.load();
+    };
+  }
+}
+
+TEST_CASE("tpp::ThreadPool wake-up latency", "[.][benchmark]") {
+  tpp::ThreadPoolOptions options;
+  options.workers = 1;
+
+  options.idle.spins = 0;
+  options.idle.yields = 0;
+  tpp::ThreadPool parking{options};
+
+  BENCHMARK("park only") {
+    return parking.submit([] { return 1; }).get();
+  };
+
+  options.idle = tpp::IdlePolicy{};
+  tpp::ThreadPool spinning{options};
+
+  BENCHMARK("spin then park") {
+    return spinning.submit([] { return 1; }).get();
+  };
+
+  WARN("park only wake-up p50 < " << parking.wakeup_latency().percentile(50)
+       << "ns, p99 < " << parking.wakeup_latency().percentile(99) << "ns");
+}
+
+TEST_CASE("tpp::ThreadPool batch submission", "[.][benchmark]") {
+  constexpr std::size_t count = 4'096;
+
+  tpp::ThreadPool pool{std::thread::hardware_concurrency()};
+  std::atomic<std::size_t> done{0};
+
+  BENCHMARK("add_task x " + std::to_string(count)) {
+    done = 0;
+    for (std::size_t i = 0; i < count; ++i)
+      pool.add_task([&] { ++done; });
+    wait_until(done, count);
+    return done.load();
+  };
+
+  std::vector<std::function<void()>> tasks(count, [&] { ++done; });
+  BENCHMARK("add_tasks of " + std::to_string(count)) {
+    done = 0;
+    pool.add_tasks(tasks.begin(), tasks.end());
+    wait_until(done, count);
+    return done.load();
+  };
+}
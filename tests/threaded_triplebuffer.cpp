@@ -0,0 +1,120 @@
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+
+#include "toypp/threaded/doublebuffer.hpp"
+#include "toypp/threaded/histogram.hpp"
+#include "toypp/threaded/triplebuffer.hpp"
+
+TEST_CASE("tpp::TripleBuffer") {
+  SECTION("swaps") {
+    tpp::TripleBuffer<std::vector<int>> tbuff{};
+
+    CHECK_FALSE(tbuff.reader_arrive());  // nothing published yet.
+    auto* reader_ptr = std::addressof(tbuff.reader_buffer());
+
+    tbuff.writer_buffer() = {1};
+    auto* first_ptr = std::addressof(tbuff.writer_buffer());
+    tbuff.writer_arrive();
+    REQUIRE(std::addressof(tbuff.writer_buffer()) != first_ptr);
+    REQUIRE(std::addressof(tbuff.writer_buffer()) != reader_ptr);
+
+    tbuff.writer_buffer() = {2};
+    tbuff.writer_arrive();  // {1} is skipped, the reader gets the latest.
+    tbuff.writer_buffer() = {3};  // not published.
+
+    REQUIRE(tbuff.reader_arrive());
+    REQUIRE(tbuff.reader_buffer() == std::vector<int>{2});
+    CHECK_FALSE(tbuff.reader_arrive());
+    REQUIRE(tbuff.reader_buffer() == std::vector<int>{2});
+
+    tbuff.writer_arrive();
+    REQUIRE(tbuff.reader_arrive());
+    REQUIRE(tbuff.reader_buffer() == std::vector<int>{3});
+  }
+
+  SECTION("latest-complete-value") {
+    struct Value {
+      std::uint64_t a = 0;
+      std::uint64_t b = 0;
+    };
+    constexpr std::uint64_t count_max = 100'000;
+    tpp::TripleBuffer<Value> tbuff{};
+
+    std::thread writer([&] {
+      for (std::uint64_t n = 1; n <= count_max; ++n) {
+        tbuff.writer_buffer().a = n;
+        tbuff.writer_buffer().b = n;
+        tbuff.writer_arrive();
+      }
+    });
+
+    std::size_t torn = 0;
+    std::size_t backwards = 0;
+    std::uint64_t last = 0;
+    while (last < count_max) {
+      if (!tbuff.reader_arrive()) {
+        std::this_thread::yield();
+        continue;
+      }
+      const auto& value = tbuff.reader_buffer();
+      torn += value.a != value.b;
+      backwards += value.a <= last;
+      last = value.a;
+    }
+    writer.join();
+
+    REQUIRE(torn == 0);
+    REQUIRE(backwards == 0);
+  }
+}
+
+TEST_CASE("tpp::TripleBuffer latency", "[.][benchmark]") {
+  constexpr std::size_t rounds = 1'000;
+
+  // the writer publishes a timestamp each round, while the reader keeps
+  // picking up whatever's latest; the writer's time to publish, and how
+  // old values are when the reader first sees them, make the latencies.
+  auto measure = [&](const char* name, auto& buffer) {
+    tpp::LatencyHistogram publish;
+    tpp::LatencyHistogram age;
+    std::atomic<bool> done{false};
+
+    std::thread reader([&] {
+      std::int64_t last = 0;
+      while (!done) {
+        buffer.reader_arrive();
+        const auto stamp = buffer.reader_buffer();
+        if (stamp > last) {
+          age.record(tpp::steady_clock_ns() - stamp);
+          last = stamp;
+        }
+        std::this_thread::yield();
+      }
+    });
+
+    for (std::size_t i = 0; i < rounds; ++i) {
+      const auto start = tpp::steady_clock_ns();
+      buffer.writer_buffer() = start;
+      buffer.writer_arrive();
+      publish.record(tpp::steady_clock_ns() - start);
+      std::this_thread::yield();  // gives the reader a chance each round.
+    }
+    done = true;
+    reader.join();
+
+    WARN(name << " publish p50 < " << publish.percentile(50)
+         << "ns, p99 < " << publish.percentile(99) << "ns; age p50 < "
+         << age.percentile(50) << "ns, p99 < " << age.percentile(99)
+         << "ns");
+  };
+
+  tpp::TripleBuffer<std::int64_t> triple{};
+  measure("TripleBuffer", triple);
+
+  tpp::DoubleBuffer<std::int64_t> dbuff{};
+  measure("DoubleBuffer", dbuff);
+}
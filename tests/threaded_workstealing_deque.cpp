@@ -0,0 +1,71 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+
+#include "toypp/threaded/workstealing_deque.hpp"
+
+TEST_CASE("tpp::WorkStealingDeque") {
+  SECTION("owner push-pop") {
+    tpp::WorkStealingDeque<int> deque{2};
+
+    CHECK(deque.empty());
+    REQUIRE(deque.pop() == std::nullopt);
+
+    for (int i = 0; i < 10; ++i)  // grows past initial capacity.
+      deque.push(i);
+
+    CHECK(deque.size() == 10);
+    REQUIRE(deque.steal() == 0);
+    REQUIRE(deque.pop() == 9);
+    REQUIRE(deque.pop() == 8);
+    CHECK(deque.size() == 7);
+  }
+
+  SECTION("owner-with-thieves") {
+    constexpr int count_max = 100'000;
+    tpp::WorkStealingDeque<int> deque{16};
+
+    std::atomic<bool> done{false};
+    std::atomic<long long> stolen_sum{0};
+    std::atomic<int> stolen_count{0};
+
+    auto thief = [&] {
+      while (!done.load() || !deque.empty()) {
+        if (auto value = deque.steal()) {
+          stolen_sum += *value;
+          ++stolen_count;
+        }
+      }
+    };
+
+    std::vector<std::thread> thieves;
+    for (int i = 0; i < 3; ++i)
+      thieves.emplace_back(thief);
+
+    long long popped_sum = 0;
+    int popped_count = 0;
+    for (int i = 0; i < count_max; ++i) {
+      deque.push(i);
+      if (i % 3 == 0) {
+        if (auto value = deque.pop()) {
+          popped_sum += *value;
+          ++popped_count;
+        }
+      }
+    }
+    while (auto value = deque.pop()) {
+      popped_sum += *value;
+      ++popped_count;
+    }
+    done = true;
+
+    for (auto& thread : thieves)
+      thread.join();
+
+    REQUIRE(popped_count + stolen_count == count_max);
+    REQUIRE(popped_sum + stolen_sum ==
+            static_cast<long long>(count_max) * (count_max - 1) / 2);
+  }
+}
@@ -0,0 +1,103 @@
+#include <array>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+
+#include "toypp/uniquefunction.hpp"
+#include "toypp/uniqueptr.hpp"
+
+namespace {
+
+struct Counted {
+  int* destroyed;
+
+  explicit Counted(int* counter) noexcept : destroyed(counter) {}
+  Counted(Counted&& other) noexcept
+    : destroyed(std::exchange(other.destroyed, nullptr))
+  {}
+  ~Counted() { if (destroyed) ++*destroyed; }
+
+  int operator()(int x) const { return x * 2; }
+};
+
+}  // namespace
+
+TEST_CASE("tpp::UniqueFunction") {
+  SECTION("call") {
+    tpp::UniqueFunction<int(int, int)> add = [](int a, int b) { return a + b; };
+    REQUIRE(add);
+    REQUIRE(add(40, 2) == 42);
+
+    tpp::UniqueFunction<void(std::string&)> append =
+        [](std::string& str) { str += "!"; };
+    std::string str = "hi";
+    append(str);
+    REQUIRE(str == "hi!");
+  }
+
+  SECTION("empty") {
+    tpp::UniqueFunction<void()> fn;
+    CHECK_FALSE(fn);
+    REQUIRE_THROWS_AS(fn(), std::bad_function_call);
+
+    fn = [] {};
+    CHECK(fn);
+    fn = nullptr;
+    CHECK_FALSE(fn);
+  }
+
+  SECTION("move-only-capture") {
+    auto ptr = tpp::make_unique<int>(42);
+    tpp::UniqueFunction<int()> fn = [p = std::move(ptr)] { return *p; };
+
+    auto other = std::move(fn);
+    CHECK_FALSE(fn);
+    REQUIRE(other() == 42);
+  }
+
+  SECTION("inline-and-heap-storage") {
+    int destroyed = 0;
+    {
+      tpp::UniqueFunction<int(int), 16> small = Counted{&destroyed};
+      auto moved = std::move(small);
+      REQUIRE(moved(21) == 42);
+    }
+    REQUIRE(destroyed == 1);
+
+    std::array<char, 128> big{};
+    big[0] = 'x';
+    tpp::UniqueFunction<char(), 16> heap = [big] { return big[0]; };
+    auto moved = std::move(heap);
+    REQUIRE(moved() == 'x');
+  }
+}
+
+TEST_CASE("tpp::UniqueFunction vs std::function", "[.][benchmark]") {
+  constexpr std::size_t count = 1024;
+
+  // 32 bytes of captures; too big for std::function's local storage.
+  void* a = nullptr;
+  void* b = nullptr;
+  void* c = nullptr;
+  std::size_t sum = 0;
+  auto make_task = [&](std::size_t i) {
+    return [a, b, c, i, &sum] { sum += i + (a == b) + (b == c); };
+  };
+
+  BENCHMARK("std::function enqueue/dequeue") {
+    std::vector<std::function<void()>> queue(count);
+    for (std::size_t i = 0; i < count; ++i) queue[i] = make_task(i);
+    for (auto& task : queue) { task(); task = nullptr; }
+    return sum;
+  };
+
+  BENCHMARK("tpp::UniqueFunction enqueue/dequeue") {
+    std::vector<tpp::UniqueFunction<void(), 48>> queue(count);
+    for (std::size_t i = 0; i < count; ++i) queue[i] = make_task(i);
+    for (auto& task : queue) { task(); task = nullptr; }
+    return sum;
+  };
+}
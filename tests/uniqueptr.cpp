@@ -64,3 +64,48 @@ TEST_CASE("[tpp::uniqueptr]")
   static_assert(
       std::is_constructible<decltype(e), decltype(std::move(e))>::value);
 }
+
+namespace {
+
+struct Counted {
+  static inline int destroyed = 0;
+  ~Counted() { ++destroyed; }
+};
+
+}  // namespace
+
+TEST_CASE("[tpp::uniqueptr] move")
+{
+  Counted::destroyed = 0;
+
+  SECTION("construct")
+  {
+    {
+      tpp::UniquePtr<Counted> a(new Counted);
+      Counted* const raw = a.get();
+
+      tpp::UniquePtr<Counted> b(std::move(a));
+      REQUIRE_FALSE(a);
+      REQUIRE(a.get() == nullptr);
+      REQUIRE(b.get() == raw);
+      REQUIRE(Counted::destroyed == 0);
+    }
+    REQUIRE(Counted::destroyed == 1);
+  }
+
+  SECTION("assign")
+  {
+    {
+      tpp::UniquePtr<Counted> a(new Counted);
+      tpp::UniquePtr<Counted> b(new Counted);
+      Counted* const raw = a.get();
+
+      b = std::move(a);
+      REQUIRE(Counted::destroyed == 1);  // b's old pointee.
+      REQUIRE_FALSE(a);
+      REQUIRE(a.get() == nullptr);
+      REQUIRE(b.get() == raw);
+    }
+    REQUIRE(Counted::destroyed == 2);
+  }
+}